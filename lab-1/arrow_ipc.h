@@ -0,0 +1,836 @@
+#pragma once
+
+#include <algorithm>   // std::stable_sort, std::max
+#include <bit>         // std::endian
+#include <cstdint>     // std::uint8_t, std::int32_t, std::int64_t
+#include <cstring>     // std::memcpy, std::memcmp
+#include <fstream>     // std::ofstream
+#include <iostream>    // std::cerr
+#include <optional>    // std::optional
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <type_traits> // std::is_same_v, std::decay_t
+#include <utility>     // std::pair
+#include <variant>     // std::visit, std::get_if
+#include <vector>      // std::vector
+
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#include "metrics.h" // lab_metrics
+#include "table.h"   // Table, Column, Schema
+
+// Буферы Arrow пишутся в порядке байтов машины, а схема объявляет
+// little-endian
+static_assert(std::endian::native == std::endian::little);
+
+/// Вариант формата Arrow IPC
+enum class ArrowFormat {
+  stream, ///< Поток сообщений (.arrows), читается последовательно
+  file    ///< Файл с оглавлением (.arrow), допускает произвольный доступ
+};
+
+namespace detail {
+
+/**
+ * @brief Объект flatbuffer для записи: таблица, строка или вектор
+ *
+ * Сообщения Arrow IPC - flatbuffers по схемам Message.fbs/Schema.fbs.
+ * Их немного и они маленькие, поэтому вместо генератора flatc дерево
+ * сообщения собирается из FbNode и сериализуется FbWriter.
+ */
+struct FbNode {
+  enum class Kind { table, string, structs, tables };
+
+  /// Поле таблицы: скаляр size байт либо ссылка на дочерний объект
+  struct Field {
+    std::uint16_t id;
+    std::uint8_t size;
+    std::uint64_t scalar;
+    std::vector<FbNode> child;
+  };
+
+  Kind kind{Kind::table};
+  std::vector<Field> fields; ///< Поля таблицы
+  std::string bytes;         ///< Строка или элементы вектора структур
+  std::size_t align{1};      ///< Выравнивание структур
+  std::size_t count{0};      ///< Число структур
+  std::vector<FbNode> items; ///< Элементы вектора таблиц
+
+  /// Добавить скалярное поле (size - 1, 2, 4 или 8 байт)
+  FbNode &scalar(std::uint16_t id, std::uint8_t size, std::uint64_t v) {
+    fields.push_back({id, size, v, {}});
+    return *this;
+  }
+
+  /// Добавить поле-ссылку на таблицу, строку или вектор
+  FbNode &child(std::uint16_t id, FbNode node) {
+    fields.push_back({id, 4, 0, {}});
+    fields.back().child.push_back(std::move(node));
+    return *this;
+  }
+};
+
+inline FbNode fb_string(std::string_view s) {
+  FbNode n;
+  n.kind = FbNode::Kind::string;
+  n.bytes = s;
+  return n;
+}
+
+inline FbNode fb_structs(std::string bytes, std::size_t count,
+                         std::size_t align) {
+  FbNode n;
+  n.kind = FbNode::Kind::structs;
+  n.bytes = std::move(bytes);
+  n.count = count;
+  n.align = align;
+  return n;
+}
+
+inline FbNode fb_tables(std::vector<FbNode> items) {
+  FbNode n;
+  n.kind = FbNode::Kind::tables;
+  n.items = std::move(items);
+  return n;
+}
+
+/**
+ * @brief Сериализация FbNode в flatbuffer
+ *
+ * Объекты пишутся от корня к листьям, так что ссылки (беззнаковые
+ * смещения) всегда указывают вперёд; vtable таблицы пишется прямо
+ * перед ней. Скаляры выравниваются по своему размеру, весь буфер
+ * дополняется до кратного 8.
+ */
+class FbWriter {
+public:
+  std::string finish(const FbNode &root) {
+    buf.assign(4, '\0');
+    patch<std::uint32_t>(0, static_cast<std::uint32_t>(write(root)));
+    pad(8);
+    return std::move(buf);
+  }
+
+private:
+  std::string buf;
+
+  void pad(std::size_t a) { buf.append((a - buf.size() % a) % a, '\0'); }
+
+  template <class T> void patch(std::size_t pos, T v) {
+    std::memcpy(buf.data() + pos, &v, sizeof(T));
+  }
+
+  template <class T> void put(T v) {
+    buf.append(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
+
+  std::size_t write(const FbNode &n) {
+    switch (n.kind) {
+    case FbNode::Kind::string: {
+      pad(4);
+      const std::size_t pos = buf.size();
+      put(static_cast<std::uint32_t>(n.bytes.size()));
+      buf += n.bytes;
+      buf += '\0';
+      return pos;
+    }
+    case FbNode::Kind::structs: {
+      pad(4);
+      if ((buf.size() + 4) % n.align != 0)
+        buf.append(n.align - (buf.size() + 4) % n.align, '\0');
+      const std::size_t pos = buf.size();
+      put(static_cast<std::uint32_t>(n.count));
+      buf += n.bytes;
+      return pos;
+    }
+    case FbNode::Kind::tables: {
+      pad(4);
+      const std::size_t pos = buf.size();
+      put(static_cast<std::uint32_t>(n.items.size()));
+      buf.append(4 * n.items.size(), '\0');
+      for (std::size_t i{0}; i < n.items.size(); ++i) {
+        const std::size_t slot = pos + 4 + 4 * i;
+        patch<std::uint32_t>(slot, write(n.items[i]) - slot);
+      }
+      return pos;
+    }
+    default:
+      return write_table(n);
+    }
+  }
+
+  std::size_t write_table(const FbNode &n) {
+    std::vector<const FbNode::Field *> fields;
+    std::uint16_t ids{0};
+    for (const auto &f : n.fields) {
+      fields.push_back(&f);
+      ids = std::max<std::uint16_t>(ids, f.id + 1);
+    }
+    std::stable_sort(fields.begin(), fields.end(),
+                     [](auto a, auto b) { return a->size > b->size; });
+
+    const std::size_t vt_size = 4 + 2 * ids;
+    pad(2);
+    const std::size_t vt = buf.size();
+    buf.append(vt_size, '\0');
+    pad(4);
+    const std::size_t table = buf.size();
+    buf.append(4, '\0');
+
+    std::vector<std::pair<std::size_t, const FbNode *>> children;
+    for (const auto *f : fields) {
+      pad(f->size);
+      patch<std::uint16_t>(vt + 4 + 2 * f->id,
+                           static_cast<std::uint16_t>(buf.size() - table));
+      if (!f->child.empty())
+        children.emplace_back(buf.size(), &f->child.front());
+      buf.append(reinterpret_cast<const char *>(&f->scalar), f->size);
+    }
+    patch<std::uint16_t>(vt, static_cast<std::uint16_t>(vt_size));
+    patch<std::uint16_t>(vt + 2,
+                         static_cast<std::uint16_t>(buf.size() - table));
+    patch<std::int32_t>(table, static_cast<std::int32_t>(table - vt));
+
+    for (auto [slot, child] : children)
+      patch<std::uint32_t>(slot,
+                           static_cast<std::uint32_t>(write(*child) - slot));
+    return table;
+  }
+};
+
+/**
+ * @brief Таблица flatbuffer для чтения
+ *
+ * Смещения проверяются по границам буфера; поле, выходящее за них,
+ * читается как отсутствующее.
+ */
+class FbView {
+public:
+  FbView() = default;
+  FbView(const std::uint8_t *data, std::size_t size, std::size_t pos)
+      : data(data), size(size), pos(pos), valid(pos + 4 <= size) {}
+
+  /// Корневая таблица буфера
+  static FbView root(const std::uint8_t *data, std::size_t size) {
+    if (size < 4)
+      return {};
+    return FbView(data, size, read<std::uint32_t>(data, 0));
+  }
+
+  explicit operator bool() const { return valid; }
+
+  template <class T> T scalar(std::uint16_t id, T def = T{}) const {
+    const std::size_t at = field(id);
+    return at && at + sizeof(T) <= size ? read<T>(data, at) : def;
+  }
+
+  /// Дочерняя таблица поля id
+  FbView table(std::uint16_t id) const {
+    const std::size_t at = target(id);
+    return at ? FbView(data, size, at) : FbView();
+  }
+
+  /// Строка поля id
+  std::string_view string(std::uint16_t id) const {
+    const auto [begin, n] = vector(id, 1);
+    return {reinterpret_cast<const char *>(begin), n};
+  }
+
+  /// Начало и длина вектора поля id с элементами elem байт
+  std::pair<const std::uint8_t *, std::size_t>
+  vector(std::uint16_t id, std::size_t elem) const {
+    const std::size_t at = target(id);
+    if (!at)
+      return {nullptr, 0};
+    const std::size_t n = read<std::uint32_t>(data, at);
+    if (at + 4 + n * elem > size)
+      return {nullptr, 0};
+    return {data + at + 4, n};
+  }
+
+  /// Элемент i вектора таблиц поля id
+  FbView table_at(std::uint16_t id, std::size_t i) const {
+    const auto [begin, n] = vector(id, 4);
+    if (i >= n)
+      return {};
+    const std::size_t slot = begin - data + 4 * i;
+    return FbView(data, size, slot + read<std::uint32_t>(data, slot));
+  }
+
+  template <class T>
+  static T read(const std::uint8_t *data, std::size_t at) {
+    T v;
+    std::memcpy(&v, data + at, sizeof(T));
+    return v;
+  }
+
+private:
+  const std::uint8_t *data{nullptr};
+  std::size_t size{0}, pos{0};
+  bool valid{false};
+
+  /// Абсолютное смещение поля id либо 0, если поля нет
+  std::size_t field(std::uint16_t id) const {
+    if (!valid)
+      return 0;
+    const std::size_t vt = pos - read<std::int32_t>(data, pos);
+    if (vt + 4 > size)
+      return 0;
+    const std::size_t vt_size = read<std::uint16_t>(data, vt);
+    if (4 + 2 * std::size_t{id} + 2 > vt_size || vt + vt_size > size)
+      return 0;
+    const std::uint16_t off = read<std::uint16_t>(data, vt + 4 + 2 * id);
+    return off ? pos + off : 0;
+  }
+
+  /// Объект, на который ссылается поле id, либо 0
+  std::size_t target(std::uint16_t id) const {
+    const std::size_t at = field(id);
+    if (!at || at + 4 > size)
+      return 0;
+    const std::size_t t = at + read<std::uint32_t>(data, at);
+    return t + 4 <= size ? t : 0;
+  }
+};
+
+// Номера из Schema.fbs и Message.fbs
+inline constexpr std::int16_t arrow_metadata_v5 = 4;
+inline constexpr std::uint8_t arrow_header_schema = 1;
+inline constexpr std::uint8_t arrow_header_dictionary = 2;
+inline constexpr std::uint8_t arrow_header_record_batch = 3;
+inline constexpr std::uint8_t arrow_type_int = 2;
+inline constexpr std::uint8_t arrow_type_utf8 = 5;
+inline constexpr std::uint8_t arrow_type_decimal = 7;
+
+/// Точность decimal-столбцов (значения int64 - до 19 десятичных знаков)
+inline constexpr std::int32_t arrow_decimal_precision = 19;
+
+/// Тело сообщения: буферы, выровненные по 8 байт, и их описания
+struct ArrowBody {
+  std::string bytes;   ///< Содержимое буферов
+  std::string nodes;   ///< FieldNode: длина и число null
+  std::string buffers; ///< Buffer: смещение и длина в bytes
+  std::size_t n_nodes{0}, n_buffers{0};
+
+  void node(std::int64_t length) {
+    const std::int64_t v[2] = {length, 0};
+    nodes.append(reinterpret_cast<const char *>(v), sizeof(v));
+    ++n_nodes;
+  }
+
+  void buffer(const void *p, std::size_t n) {
+    const std::int64_t v[2] = {static_cast<std::int64_t>(bytes.size()),
+                               static_cast<std::int64_t>(n)};
+    buffers.append(reinterpret_cast<const char *>(v), sizeof(v));
+    ++n_buffers;
+    bytes.append(static_cast<const char *>(p), n);
+    bytes.append((8 - bytes.size() % 8) % 8, '\0');
+  }
+
+  /// Столбец строк: пустая маска null, смещения int32 и символы
+  template <class Get>
+  void utf8(std::size_t length, Get get) {
+    node(length);
+    buffer(nullptr, 0);
+    std::vector<std::int32_t> offsets{0};
+    std::string chars;
+    for (std::size_t r{0}; r < length; ++r) {
+      chars += get(r);
+      offsets.push_back(static_cast<std::int32_t>(chars.size()));
+    }
+    buffer(offsets.data(), offsets.size() * sizeof(std::int32_t));
+    buffer(chars.data(), chars.size());
+  }
+
+  /// Столбец значений фиксированной длины: пустая маска null и значения
+  template <class T> void fixed(const std::vector<T> &values) {
+    node(values.size());
+    buffer(nullptr, 0);
+    buffer(values.data(), values.size() * sizeof(T));
+  }
+
+  /// Таблица RecordBatch с описанием этого тела
+  FbNode record_batch(std::int64_t length) const {
+    return FbNode()
+        .scalar(0, 8, length)
+        .child(1, fb_structs(nodes, n_nodes, 8))
+        .child(2, fb_structs(buffers, n_buffers, 8));
+  }
+};
+
+/// Тип Int{bitWidth, is_signed}
+inline FbNode arrow_int(std::int32_t bits) {
+  return FbNode().scalar(0, 4, bits).scalar(1, 1, 1);
+}
+
+/// Таблица Schema по схеме Table
+inline FbNode arrow_schema(const Table &table) {
+  std::vector<FbNode> fields;
+  for (std::size_t c{0}; c < table.schema.size(); ++c) {
+    const auto &spec = table.schema[c];
+    FbNode field;
+    field.child(0, fb_string(spec.name)).scalar(1, 1, 0);
+    switch (spec.type) {
+    case ColumnType::string:
+      field.scalar(2, 1, arrow_type_utf8).child(3, FbNode());
+      break;
+    case ColumnType::dictionary:
+      // Коды словаря упорядочены как строки - объявляем isOrdered
+      field.scalar(2, 1, arrow_type_utf8)
+          .child(3, FbNode())
+          .child(4, FbNode()
+                        .scalar(0, 8, c)
+                        .child(1, arrow_int(32))
+                        .scalar(2, 1, 1));
+      break;
+    case ColumnType::int32:
+      field.scalar(2, 1, arrow_type_int).child(3, arrow_int(32));
+      break;
+    case ColumnType::decimal:
+      field.scalar(2, 1, arrow_type_decimal)
+          .child(3, FbNode()
+                        .scalar(0, 4, arrow_decimal_precision)
+                        .scalar(1, 4, spec.scale)
+                        .scalar(2, 4, 128));
+      break;
+    }
+    fields.push_back(std::move(field.child(5, fb_tables({}))));
+  }
+  return FbNode().scalar(0, 2, 0).child(1, fb_tables(std::move(fields)));
+}
+
+/// Блок файла Arrow: где лежит сообщение
+struct ArrowBlock {
+  std::int64_t offset;
+  std::int32_t meta_length;
+  std::int64_t body_length;
+};
+
+/**
+ * @brief Записать сообщение: продолжение 0xFFFFFFFF, длина метаданных,
+ * flatbuffer Message и тело
+ */
+inline ArrowBlock write_message(std::ofstream &ofile, std::uint8_t type,
+                                FbNode header, const std::string &body) {
+  const std::string meta =
+      FbWriter().finish(FbNode()
+                            .scalar(0, 2, arrow_metadata_v5)
+                            .scalar(1, 1, type)
+                            .child(2, std::move(header))
+                            .scalar(3, 8, body.size()));
+  ArrowBlock block{static_cast<std::int64_t>(ofile.tellp()),
+                   static_cast<std::int32_t>(8 + meta.size()),
+                   static_cast<std::int64_t>(body.size())};
+  const std::uint32_t prefix[2] = {0xFFFFFFFF,
+                                   static_cast<std::uint32_t>(meta.size())};
+  ofile.write(reinterpret_cast<const char *>(prefix), sizeof(prefix));
+  ofile << meta << body;
+  return block;
+}
+
+/// Вектор структур Block для оглавления файла
+inline FbNode arrow_blocks(const std::vector<ArrowBlock> &blocks) {
+  std::string bytes;
+  for (const auto &b : blocks) {
+    const std::int64_t offset = b.offset, body = b.body_length;
+    const std::int32_t meta = b.meta_length, padding = 0;
+    bytes.append(reinterpret_cast<const char *>(&offset), 8);
+    bytes.append(reinterpret_cast<const char *>(&meta), 4);
+    bytes.append(reinterpret_cast<const char *>(&padding), 4);
+    bytes.append(reinterpret_cast<const char *>(&body), 8);
+  }
+  return fb_structs(std::move(bytes), blocks.size(), 8);
+}
+
+} // namespace detail
+
+/**
+ * @brief Записать таблицу в формате Arrow IPC в порядке перестановки
+ *
+ * Пишутся схема, по одному DictionaryBatch на каждый словарный столбец
+ * (строки словаря, коды - индексы int32, словарь помечен упорядоченным)
+ * и один RecordBatch со всеми строками. Все буферы выровнены по 8 байт,
+ * null отсутствуют, так что файл можно отобразить в память и
+ * использовать без разбора. Строковые столбцы - Utf8, int - Int32,
+ * decimal - Decimal128 с точностью 19.
+ *
+ * @param filename имя файла (.arrow или .arrows)
+ * @param table таблица
+ * @param perm порядок строк
+ * @param format поток или файл с оглавлением
+ * @return true, если файл записан
+ */
+inline bool write_arrow(const std::string &filename, const Table &table,
+                        const std::vector<std::uint32_t> &perm,
+                        ArrowFormat format = ArrowFormat::file) {
+  std::ofstream ofile(filename, std::ios::binary);
+  if (!ofile.is_open()) {
+    std::cerr << "write_arrow: Couldn't open file\n";
+    return false;
+  }
+  const bool file = format == ArrowFormat::file;
+  if (file)
+    ofile.write("ARROW1\0\0", 8);
+
+  detail::write_message(ofile, detail::arrow_header_schema,
+                        detail::arrow_schema(table), "");
+
+  std::vector<detail::ArrowBlock> dictionaries, batches;
+  detail::ArrowBody body;
+  for (std::size_t c{0}; c < table.columns.size(); ++c) {
+    std::visit(
+        [&](const auto &col) {
+          using Col = std::decay_t<decltype(col)>;
+          if constexpr (std::is_same_v<Col, StringColumn>) {
+            body.utf8(perm.size(), [&](std::size_t r) { return col[perm[r]]; });
+          } else if constexpr (std::is_same_v<Col, DictionaryColumn>) {
+            detail::ArrowBody dict;
+            const auto &values = col.dict.values;
+            dict.utf8(values.size(),
+                      [&](std::size_t r) -> const std::string & {
+                        return values[r];
+                      });
+            dictionaries.push_back(detail::write_message(
+                ofile, detail::arrow_header_dictionary,
+                detail::FbNode().scalar(0, 8, c).child(
+                    1, dict.record_batch(values.size())),
+                dict.bytes));
+
+            std::vector<std::int32_t> codes(perm.size());
+            for (std::size_t r{0}; r < perm.size(); ++r)
+              codes[r] = static_cast<std::int32_t>(col.codes[perm[r]]);
+            body.fixed(codes);
+          } else if constexpr (std::is_same_v<Col, IntColumn>) {
+            std::vector<std::int32_t> values(perm.size());
+            for (std::size_t r{0}; r < perm.size(); ++r)
+              values[r] = col.values[perm[r]];
+            body.fixed(values);
+          } else {
+            // Decimal128: младшие 8 байт - значение, старшие - знак
+            std::vector<std::int64_t> values(2 * perm.size());
+            for (std::size_t r{0}; r < perm.size(); ++r) {
+              values[2 * r] = col.values[perm[r]];
+              values[2 * r + 1] = col.values[perm[r]] < 0 ? -1 : 0;
+            }
+            body.node(perm.size());
+            body.buffer(nullptr, 0);
+            body.buffer(values.data(), values.size() * sizeof(std::int64_t));
+          }
+        },
+        table.columns[c]);
+  }
+  batches.push_back(detail::write_message(ofile,
+                                          detail::arrow_header_record_batch,
+                                          body.record_batch(perm.size()),
+                                          body.bytes));
+
+  const std::uint32_t eos[2] = {0xFFFFFFFF, 0};
+  ofile.write(reinterpret_cast<const char *>(eos), sizeof(eos));
+  if (file) {
+    const std::string footer = detail::FbWriter().finish(
+        detail::FbNode()
+            .scalar(0, 2, detail::arrow_metadata_v5)
+            .child(1, detail::arrow_schema(table))
+            .child(2, detail::arrow_blocks(dictionaries))
+            .child(3, detail::arrow_blocks(batches)));
+    const std::int32_t length = static_cast<std::int32_t>(footer.size());
+    ofile << footer;
+    ofile.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    ofile.write("ARROW1", 6);
+  }
+  ofile.flush();
+  const std::streamoff written = ofile.tellp();
+  lab_metrics().bytes_written.add(written > 0 ? written : 0);
+  return ofile.good();
+}
+
+namespace detail {
+
+/// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st {};
+    ::fstat(fd, &st);
+    size = static_cast<std::size_t>(st.st_size);
+    if (size > 0) {
+      void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+        data = static_cast<const std::uint8_t *>(p);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+    if (data)
+      ::munmap(const_cast<std::uint8_t *>(data), size);
+  }
+
+  const std::uint8_t *data{nullptr};
+  std::size_t size{0};
+};
+
+/// Последовательное чтение узлов и буферов RecordBatch
+struct ArrowBatchReader {
+  FbView batch;
+  const std::uint8_t *body;
+  std::size_t body_size;
+  std::size_t next_node{0}, next_buffer{0};
+
+  /// Длина и число null очередного узла
+  std::pair<std::int64_t, std::int64_t> node() {
+    const auto [p, n] = batch.vector(1, 16);
+    if (next_node >= n)
+      return {-1, 0};
+    const std::size_t at = 16 * next_node++;
+    return {FbView::read<std::int64_t>(p, at),
+            FbView::read<std::int64_t>(p, at + 8)};
+  }
+
+  /// Очередной буфер (nullptr при выходе за тело)
+  std::pair<const std::uint8_t *, std::size_t> buffer() {
+    const auto [p, n] = batch.vector(2, 16);
+    if (next_buffer >= n)
+      return {nullptr, 0};
+    const std::size_t at = 16 * next_buffer++;
+    const auto offset = FbView::read<std::int64_t>(p, at);
+    const auto length = FbView::read<std::int64_t>(p, at + 8);
+    if (offset < 0 || length < 0 ||
+        static_cast<std::size_t>(offset + length) > body_size)
+      return {nullptr, 0};
+    return {body + offset, static_cast<std::size_t>(length)};
+  }
+
+  /**
+   * @brief Прочитать столбец Utf8, вызывая emit для каждой строки
+   * @return Длина столбца либо -1, если буферы не согласуются с ней
+   */
+  template <class Emit> std::int64_t utf8(Emit emit) {
+    const auto [length, nulls] = node();
+    buffer();
+    const auto [offsets, offsets_size] = buffer();
+    const auto [chars, chars_size] = buffer();
+    if (length < 0 || nulls != 0 ||
+        offsets_size < (length + 1) * sizeof(std::int32_t))
+      return -1;
+    for (std::int64_t r{0}; r < length; ++r) {
+      const auto b = FbView::read<std::int32_t>(offsets, 4 * r);
+      const auto e = FbView::read<std::int32_t>(offsets, 4 * (r + 1));
+      if (b < 0 || e < b || static_cast<std::size_t>(e) > chars_size)
+        return -1;
+      emit(std::string_view(reinterpret_cast<const char *>(chars) + b, e - b));
+    }
+    return length;
+  }
+
+  /**
+   * @brief Прочитать столбец значений по width байт, дописав его в out
+   * @return Длина столбца либо -1, если буфер короче неё
+   */
+  template <class T>
+  std::int64_t fixed(std::vector<T> &out, std::size_t width) {
+    const auto [length, nulls] = node();
+    buffer();
+    const auto [values, size] = buffer();
+    if (length < 0 || nulls != 0 || size < length * width)
+      return -1;
+    for (std::int64_t r{0}; r < length; ++r)
+      out.push_back(FbView::read<T>(values, width * r));
+    return length;
+  }
+
+  /**
+   * @brief Прочитать столбец Decimal128, дописав его в out
+   * @return Длина столбца либо -1, если буфер короче неё или значение
+   * не помещается в int64 (старшие 8 байт - не расширение знака)
+   */
+  std::int64_t decimal128(std::vector<std::int64_t> &out) {
+    const auto [length, nulls] = node();
+    buffer();
+    const auto [values, size] = buffer();
+    if (length < 0 || nulls != 0 || size < length * std::size_t{16})
+      return -1;
+    for (std::int64_t r{0}; r < length; ++r) {
+      const auto low = FbView::read<std::int64_t>(values, 16 * r);
+      const auto high = FbView::read<std::int64_t>(values, 16 * r + 8);
+      if (high != (low < 0 ? -1 : 0))
+        return -1;
+      out.push_back(low);
+    }
+    return length;
+  }
+};
+
+} // namespace detail
+
+/**
+ * @brief Прочитать таблицу из файла или потока Arrow IPC
+ *
+ * Файл отображается в память, буферы столбцов копируются в Table без
+ * разбора текста. Поддерживается то, что пишет write_arrow(): Utf8
+ * (в том числе со словарём с индексами int32), Int32 и Decimal128 со
+ * значениями в пределах int64 (более широкие значения - ошибка), без
+ * null и без сжатия. Пакетов RecordBatch может быть несколько.
+ *
+ * @param filename имя файла (.arrow или .arrows)
+ * @return Таблица либо std::nullopt при ошибке
+ */
+inline std::optional<Table> read_arrow(const std::string &filename) {
+  using detail::FbView;
+  const detail::MappedFile file(filename);
+  if (!file.data) {
+    std::cerr << "read_arrow: Couldn't open file\n";
+    return std::nullopt;
+  }
+  auto fail = [](const char *what) {
+    std::cerr << "read_arrow: " << what << '\n';
+    return std::nullopt;
+  };
+
+  std::size_t pos{0};
+  if (file.size >= 8 && std::memcmp(file.data, "ARROW1", 6) == 0)
+    pos = 8;
+
+  std::optional<Table> table;
+  std::vector<std::int64_t> dictionary_ids;
+  while (pos + 8 <= file.size) {
+    std::uint32_t length = FbView::read<std::uint32_t>(file.data, pos);
+    std::size_t meta = pos + 4;
+    if (length == 0xFFFFFFFF) {
+      length = FbView::read<std::uint32_t>(file.data, pos + 4);
+      meta = pos + 8;
+    }
+    if (length == 0)
+      break;
+    if (meta + length > file.size)
+      return fail("truncated message");
+
+    const FbView message = FbView::root(file.data + meta, length);
+    const auto body_length = message.scalar<std::int64_t>(3);
+    const std::uint8_t *body = file.data + meta + length;
+    if (body_length < 0 ||
+        meta + length + static_cast<std::size_t>(body_length) > file.size)
+      return fail("truncated body");
+    pos = meta + length + body_length;
+
+    const auto type = message.scalar<std::uint8_t>(1);
+    const FbView header = message.table(2);
+    if (type == detail::arrow_header_schema) {
+      Schema schema;
+      for (std::size_t f{0}; header.table_at(1, f); ++f) {
+        const FbView field = header.table_at(1, f);
+        const FbView dictionary = field.table(4);
+        const FbView type_table = field.table(3);
+        ColumnSpec spec{std::string(field.string(0)), ColumnType::string};
+        switch (field.scalar<std::uint8_t>(2)) {
+        case detail::arrow_type_utf8:
+          spec.type =
+              dictionary ? ColumnType::dictionary : ColumnType::string;
+          break;
+        case detail::arrow_type_int:
+          if (dictionary || type_table.scalar<std::int32_t>(0) != 32)
+            return fail("unsupported integer column");
+          spec.type = ColumnType::int32;
+          break;
+        case detail::arrow_type_decimal:
+          if (dictionary || type_table.scalar<std::int32_t>(2, 128) != 128)
+            return fail("unsupported decimal column");
+          spec.type = ColumnType::decimal;
+          spec.scale = type_table.scalar<std::int32_t>(1);
+          break;
+        default:
+          return fail("unsupported column type");
+        }
+        if (dictionary && dictionary.table(1).scalar<std::int32_t>(0) != 32)
+          return fail("unsupported dictionary index type");
+        dictionary_ids.push_back(dictionary ? dictionary.scalar<std::int64_t>(0)
+                                            : -1);
+        schema.push_back(spec);
+      }
+      table.emplace(std::move(schema));
+    } else if (!table) {
+      return fail("message before schema");
+    } else if (type == detail::arrow_header_dictionary) {
+      const auto id = header.scalar<std::int64_t>(0);
+      std::size_t c{0};
+      while (c < dictionary_ids.size() && dictionary_ids[c] != id)
+        ++c;
+      // id -1 в dictionary_ids - у столбцов без словаря
+      auto *column = c < dictionary_ids.size()
+                         ? std::get_if<DictionaryColumn>(&table->columns[c])
+                         : nullptr;
+      if (column == nullptr)
+        return fail("unknown dictionary id");
+      auto &dict = column->dict;
+      if (!header.scalar<std::uint8_t>(2)) {
+        dict.values.clear();
+        dict.index.clear();
+      }
+      detail::ArrowBatchReader reader{header.table(1), body,
+                                      static_cast<std::size_t>(body_length)};
+      if (header.table(1).table(3))
+        return fail("compressed batches are not supported");
+      if (reader.utf8([&](std::string_view s) {
+            dict.index.emplace(std::string(s),
+                               static_cast<std::uint32_t>(dict.values.size()));
+            dict.values.emplace_back(s);
+          }) != header.table(1).scalar<std::int64_t>(0))
+        return fail("bad dictionary batch");
+    } else if (type == detail::arrow_header_record_batch) {
+      if (header.table(3))
+        return fail("compressed batches are not supported");
+      detail::ArrowBatchReader reader{header, body,
+                                      static_cast<std::size_t>(body_length)};
+      // Длина каждого столбца должна совпасть с длиной пакета, иначе
+      // rows разойдётся с размерами буферов столбцов
+      const auto rows = header.scalar<std::int64_t>(0);
+      bool ok = rows >= 0;
+      for (auto &column : table->columns) {
+        std::visit(
+            [&](auto &col) {
+              using Col = std::decay_t<decltype(col)>;
+              if constexpr (std::is_same_v<Col, StringColumn>) {
+                ok = ok && reader.utf8([&](std::string_view s) {
+                  col.push_back(s);
+                }) == rows;
+              } else if constexpr (std::is_same_v<Col, DictionaryColumn>) {
+                ok = ok && reader.fixed(col.codes, 4) == rows;
+              } else if constexpr (std::is_same_v<Col, IntColumn>) {
+                ok = ok && reader.fixed(col.values, 4) == rows;
+              } else {
+                ok = ok && reader.decimal128(col.values) == rows;
+              }
+            },
+            column);
+      }
+      if (!ok)
+        return fail("bad record batch");
+      table->rows += rows;
+    }
+  }
+  if (!table)
+    return fail("no schema");
+
+  for (auto &column : table->columns) {
+    if (auto *d = std::get_if<DictionaryColumn>(&column)) {
+      for (auto code : d->codes) {
+        if (code >= d->dict.values.size())
+          return fail("dictionary index out of range");
+      }
+      // Словарь мог быть записан не по порядку - упорядочиваем коды
+      d->dict.finalize(d->codes);
+    }
+  }
+  lab_metrics().bytes_read.add(file.size);
+  lab_metrics().rows_parsed.add(table->rows);
+  return table;
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>   // std::max, std::min
+#include <chrono>      // std::chrono::steady_clock
+#include <cstdint>     // std::uint64_t
+#include <optional>    // std::optional
+#include <string>      // std::string
+#include <thread>      // std::thread
+#include <vector>      // std::vector
+
+#include <linux/perf_event.h> // perf_event_attr, PERF_COUNT_HW_CACHE_MISSES
+#include <sys/ioctl.h>        // ioctl
+#include <sys/syscall.h>      // SYS_perf_event_open
+#include <unistd.h>           // syscall, read, close
+
+/// Пропускная способность памяти по ядрам STREAM (ГБ/с)
+struct StreamResult {
+  double copy{0};  ///< a[i] = b[i]
+  double scale{0}; ///< a[i] = q * b[i]
+  double add{0};   ///< a[i] = b[i] + c[i]
+  double triad{0}; ///< a[i] = b[i] + q * c[i]
+
+  /// Наибольшая из измеренных величин - оценка пиковой пропускной
+  double peak() const { return std::max({copy, scale, add, triad}); }
+};
+
+/**
+ * @brief Измерить достижимую пропускную способность памяти
+ *
+ * Аналог STREAM: три массива double по elements элементов (по умолчанию
+ * 3 x 128 МБ, заведомо больше кэша) делятся между потоками, для каждого
+ * ядра берётся лучший из reps запусков. Байты считаются как в STREAM:
+ * чтения и записи, без учёта чтения строки кэша перед записью.
+ *
+ * @param elements размер каждого массива
+ * @param threads число потоков
+ * @param reps число повторов
+ */
+inline StreamResult stream_bandwidth(std::size_t elements = std::size_t{1}
+                                                            << 24,
+                                     unsigned threads = 1, int reps = 5) {
+  threads = std::max(1u, threads);
+  std::vector<double> a(elements, 1.0), b(elements, 2.0), c(elements, 0.5);
+  const double q = 3.0;
+
+  auto best_of = [&](auto kernel, double words) {
+    double best{0};
+    for (int r{0}; r < reps; ++r) {
+      const auto start{std::chrono::steady_clock::now()};
+      std::vector<std::thread> workers;
+      for (unsigned t{0}; t < threads; ++t) {
+        workers.emplace_back(kernel, elements * t / threads,
+                             elements * (t + 1) / threads);
+      }
+      for (auto &w : workers)
+        w.join();
+      const auto finish{std::chrono::steady_clock::now()};
+      const std::chrono::duration<double> elapsed_seconds{finish - start};
+      best = std::max(best, words * sizeof(double) * elements /
+                                elapsed_seconds.count() * 1e-9);
+    }
+    return best;
+  };
+
+  StreamResult result;
+  result.copy = best_of(
+      [&](std::size_t b_, std::size_t e) {
+        for (auto i = b_; i < e; ++i)
+          a[i] = b[i];
+      },
+      2);
+  result.scale = best_of(
+      [&](std::size_t b_, std::size_t e) {
+        for (auto i = b_; i < e; ++i)
+          a[i] = q * b[i];
+      },
+      2);
+  result.add = best_of(
+      [&](std::size_t b_, std::size_t e) {
+        for (auto i = b_; i < e; ++i)
+          a[i] = b[i] + c[i];
+      },
+      3);
+  result.triad = best_of(
+      [&](std::size_t b_, std::size_t e) {
+        for (auto i = b_; i < e; ++i)
+          a[i] = b[i] + q * c[i];
+      },
+      3);
+  return result;
+}
+
+/**
+ * @brief Измерить пиковую скорость сравнений (в млрд. сравнений в секунду)
+ *
+ * Восемь независимых цепочек min/max над данными в кэше L1 - верхняя
+ * граница "вычислительной" производительности для сортировок сравнением.
+ */
+inline double compare_throughput(int reps = 5) {
+  constexpr std::size_t n = 4096;
+  std::vector<int> v(n);
+  for (std::size_t i{0}; i < n; ++i)
+    v[i] = static_cast<int>((i * 2654435761u) >> 7);
+
+  double best{0};
+  volatile int sink{0};
+  for (int r{0}; r < reps; ++r) {
+    int lo[8], hi[8];
+    std::fill(lo, lo + 8, v[0]);
+    std::fill(hi, hi + 8, v[0]);
+    constexpr int rounds = 256;
+    const auto start{std::chrono::steady_clock::now()};
+    for (int k{0}; k < rounds; ++k) {
+      for (std::size_t i{0}; i < n; i += 8) {
+        for (int j{0}; j < 8; ++j) {
+          lo[j] = std::min(lo[j], v[i + j] ^ k);
+          hi[j] = std::max(hi[j], v[i + j] ^ k);
+        }
+      }
+    }
+    const auto finish{std::chrono::steady_clock::now()};
+    const std::chrono::duration<double> elapsed_seconds{finish - start};
+    for (int j{0}; j < 8; ++j)
+      sink = sink + lo[j] + hi[j];
+    best = std::max(best, 2.0 * n * rounds / elapsed_seconds.count() * 1e-9);
+  }
+  return best;
+}
+
+/**
+ * @brief Счётчик трафика памяти по промахам последнего уровня кэша
+ *
+ * Использует perf_event_open (PERF_COUNT_HW_CACHE_MISSES, только
+ * пользовательский режим): каждый промах - одна строка кэша из памяти.
+ * Если счётчик недоступен (perf_event_paranoid, виртуальная машина без
+ * PMU), available() возвращает false.
+ */
+class MemoryTraffic {
+public:
+  MemoryTraffic() {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  MemoryTraffic(const MemoryTraffic &) = delete;
+  MemoryTraffic &operator=(const MemoryTraffic &) = delete;
+
+  ~MemoryTraffic() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+
+  /// Открыт ли счётчик
+  bool available() const { return fd >= 0; }
+
+  /// Обнулить и запустить счётчик
+  void start() {
+    if (fd < 0)
+      return;
+    ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  /**
+   * @brief Остановить счётчик
+   * @return Байты, прочитанные из памяти с момента start(), либо пусто,
+   * если счётчик недоступен или ничего не насчитал
+   */
+  std::optional<double> stop() {
+    if (fd < 0)
+      return std::nullopt;
+    ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    std::uint64_t misses{0};
+    if (::read(fd, &misses, sizeof(misses)) != sizeof(misses) || misses == 0)
+      return std::nullopt;
+    return static_cast<double>(misses) * line_bytes;
+  }
+
+private:
+  static constexpr double line_bytes = 64;
+  int fd{-1};
+};
+
+/// Положение запуска на модели roofline
+struct RooflinePoint {
+  double gbps{0};       ///< Достигнутая пропускная способность, ГБ/с
+  double gops{0};       ///< Достигнутая скорость операций, млрд./с
+  double intensity{0};  ///< Операций на байт
+  double attainable{0}; ///< Предел модели при данной интенсивности, млрд./с
+  std::string bound;    ///< "memory" или "compute"
+};
+
+/**
+ * @brief Поместить запуск на модель roofline
+ *
+ * Предел производительности - min(peak_gops, intensity * peak_gbps);
+ * запуск ограничен памятью, если интенсивность ниже точки перегиба
+ * peak_gops / peak_gbps.
+ *
+ * @param bytes перемещённые байты
+ * @param ops выполненные операции
+ * @param seconds время запуска
+ * @param peak_gbps пиковая пропускная способность (stream_bandwidth)
+ * @param peak_gops пиковая скорость операций (compare_throughput)
+ */
+inline RooflinePoint roofline(double bytes, double ops, double seconds,
+                              double peak_gbps, double peak_gops) {
+  RooflinePoint p;
+  seconds = std::max(seconds, 1e-12);
+  bytes = std::max(bytes, 1.0);
+  p.gbps = bytes / seconds * 1e-9;
+  p.gops = ops / seconds * 1e-9;
+  p.intensity = ops / bytes;
+  p.attainable = std::min(peak_gops, p.intensity * peak_gbps);
+  p.bound = p.intensity < peak_gops / peak_gbps ? "memory" : "compute";
+  return p;
+}
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <algorithm> // std::set_intersection, std::set_union
+#include <bit>       // std::popcount, std::countr_zero
+#include <cstdint>   // std::uint16_t, std::uint32_t, std::uint64_t
+#include <fstream>   // std::ifstream
+#include <iostream>  // std::cerr
+#include <iterator>  // std::back_inserter
+#include <string>    // std::string, std::getline
+#include <utility>   // std::move
+#include <vector>    // std::vector
+
+#include "columns.h" // SoldierColumns, Dictionary
+#include "soldier.h" // split
+
+/**
+ * @brief Сжатый битовый набор в стиле Roaring
+ *
+ * Номера строк делятся по старшим 16 битам на блоки по 65536. Блок
+ * хранится либо отсортированным массивом младших 16 бит (если в нём не
+ * больше 4096 элементов), либо битовой картой из 1024 слов - так блок
+ * никогда не занимает больше 8 КБ и разреженные блоки остаются малыми.
+ */
+class Bitmap {
+public:
+  /// Добавить номер строки (номера должны добавляться по возрастанию)
+  void push_back(std::uint32_t x) {
+    const auto key = static_cast<std::uint16_t>(x >> 16);
+    if (containers.empty() || containers.back().key != key) {
+      containers.push_back({key, {}, {}, 0});
+    }
+    auto &c = containers.back();
+    c.add(static_cast<std::uint16_t>(x));
+  }
+
+  /// Содержит ли набор номер x
+  bool contains(std::uint32_t x) const {
+    const auto key = static_cast<std::uint16_t>(x >> 16);
+    auto it = std::lower_bound(
+        containers.begin(), containers.end(), key,
+        [](const Container &c, std::uint16_t k) { return c.key < k; });
+    return it != containers.end() && it->key == key &&
+           it->contains(static_cast<std::uint16_t>(x));
+  }
+
+  /// Число элементов
+  std::size_t cardinality() const {
+    std::size_t n{0};
+    for (const auto &c : containers) {
+      n += c.card;
+    }
+    return n;
+  }
+
+  /// Все элементы по возрастанию
+  std::vector<std::uint32_t> to_vector() const {
+    std::vector<std::uint32_t> out;
+    out.reserve(cardinality());
+    for (const auto &c : containers) {
+      const std::uint32_t high = std::uint32_t{c.key} << 16;
+      if (c.bits.empty()) {
+        for (auto low : c.array)
+          out.push_back(high | low);
+      } else {
+        for (std::uint32_t w{0}; w < words; ++w) {
+          for (auto word = c.bits[w]; word != 0; word &= word - 1) {
+            out.push_back(high | w * 64 | std::countr_zero(word));
+          }
+        }
+      }
+    }
+    return out;
+  }
+
+  /// Занимаемая память в байтах
+  std::size_t bytes() const {
+    std::size_t n = containers.capacity() * sizeof(Container);
+    for (const auto &c : containers) {
+      n += c.array.capacity() * sizeof(std::uint16_t) +
+           c.bits.capacity() * sizeof(std::uint64_t);
+    }
+    return n;
+  }
+
+  /// Пересечение
+  friend Bitmap operator&(const Bitmap &a, const Bitmap &b) {
+    Bitmap out;
+    auto i = a.containers.begin(), j = b.containers.begin();
+    while (i != a.containers.end() && j != b.containers.end()) {
+      if (i->key < j->key) {
+        ++i;
+      } else if (j->key < i->key) {
+        ++j;
+      } else {
+        auto c = Container::intersect(*i, *j);
+        if (c.card > 0)
+          out.containers.push_back(std::move(c));
+        ++i;
+        ++j;
+      }
+    }
+    return out;
+  }
+
+  /// Объединение
+  friend Bitmap operator|(const Bitmap &a, const Bitmap &b) {
+    Bitmap out;
+    auto i = a.containers.begin(), j = b.containers.begin();
+    while (i != a.containers.end() || j != b.containers.end()) {
+      if (j == b.containers.end() ||
+          (i != a.containers.end() && i->key < j->key)) {
+        out.containers.push_back(*i++);
+      } else if (i == a.containers.end() || j->key < i->key) {
+        out.containers.push_back(*j++);
+      } else {
+        out.containers.push_back(Container::unite(*i, *j));
+        ++i;
+        ++j;
+      }
+    }
+    return out;
+  }
+
+  /**
+   * @brief Дополнение до диапазона [0, n)
+   * @param n число строк датасета
+   */
+  Bitmap flip(std::uint32_t n) const {
+    Bitmap out;
+    if (n == 0)
+      return out;
+    auto it = containers.begin();
+    const std::uint32_t last_key = (n - 1) >> 16;
+    for (std::uint32_t key{0}; key <= last_key; ++key) {
+      const std::uint32_t limit =
+          key == last_key ? n - (key << 16) : std::uint32_t{1} << 16;
+      Container c{static_cast<std::uint16_t>(key), {}, {}, 0};
+      c.bits.assign(words, ~std::uint64_t{0});
+      if (it != containers.end() && it->key == key) {
+        const auto other = it->as_bits();
+        for (std::uint32_t w{0}; w < words; ++w)
+          c.bits[w] &= ~other[w];
+        ++it;
+      }
+      for (std::uint32_t x = limit; x < (std::uint32_t{1} << 16); ++x) {
+        c.bits[x / 64] &= ~(std::uint64_t{1} << (x % 64));
+      }
+      c.normalize();
+      if (c.card > 0)
+        out.containers.push_back(std::move(c));
+    }
+    return out;
+  }
+
+private:
+  static constexpr std::uint32_t words = 1024;       ///< Слов в битовой карте
+  static constexpr std::uint32_t array_limit = 4096; ///< Предел массива
+
+  /// Блок из 65536 возможных номеров с общими старшими битами
+  struct Container {
+    std::uint16_t key;                ///< Старшие 16 бит номеров
+    std::vector<std::uint16_t> array; ///< Младшие биты (разреженный блок)
+    std::vector<std::uint64_t> bits;  ///< Битовая карта (плотный блок)
+    std::uint32_t card;               ///< Число элементов
+
+    bool contains(std::uint16_t x) const {
+      if (bits.empty())
+        return std::binary_search(array.begin(), array.end(), x);
+      return bits[x / 64] >> (x % 64) & 1;
+    }
+
+    void add(std::uint16_t x) {
+      if (bits.empty()) {
+        array.push_back(x);
+        if (array.size() > array_limit) {
+          bits = as_bits();
+          array.clear();
+          array.shrink_to_fit();
+        }
+      } else {
+        bits[x / 64] |= std::uint64_t{1} << (x % 64);
+      }
+      ++card;
+    }
+
+    std::vector<std::uint64_t> as_bits() const {
+      if (!bits.empty())
+        return bits;
+      std::vector<std::uint64_t> out(words, 0);
+      for (auto x : array)
+        out[x / 64] |= std::uint64_t{1} << (x % 64);
+      return out;
+    }
+
+    /// Пересчитать card и выбрать представление по числу элементов
+    void normalize() {
+      if (bits.empty()) {
+        card = array.size();
+        if (card > array_limit) {
+          bits = as_bits();
+          array.clear();
+        }
+        return;
+      }
+      card = 0;
+      for (auto w : bits)
+        card += std::popcount(w);
+      if (card <= array_limit) {
+        array.clear();
+        array.reserve(card);
+        for (std::uint32_t w{0}; w < words; ++w) {
+          for (auto word = bits[w]; word != 0; word &= word - 1) {
+            array.push_back(
+                static_cast<std::uint16_t>(w * 64 + std::countr_zero(word)));
+          }
+        }
+        bits.clear();
+      }
+    }
+
+    static Container intersect(const Container &a, const Container &b) {
+      Container c{a.key, {}, {}, 0};
+      if (a.bits.empty() && b.bits.empty()) {
+        std::set_intersection(a.array.begin(), a.array.end(),
+                              b.array.begin(), b.array.end(),
+                              std::back_inserter(c.array));
+      } else if (a.bits.empty() || b.bits.empty()) {
+        const auto &arr = a.bits.empty() ? a : b;
+        const auto &set = a.bits.empty() ? b : a;
+        for (auto x : arr.array) {
+          if (set.bits[x / 64] >> (x % 64) & 1)
+            c.array.push_back(x);
+        }
+      } else {
+        c.bits.resize(words);
+        for (std::uint32_t w{0}; w < words; ++w)
+          c.bits[w] = a.bits[w] & b.bits[w];
+      }
+      c.normalize();
+      return c;
+    }
+
+    static Container unite(const Container &a, const Container &b) {
+      Container c{a.key, {}, {}, 0};
+      if (a.bits.empty() && b.bits.empty() &&
+          a.card + b.card <= array_limit) {
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(),
+                       b.array.end(), std::back_inserter(c.array));
+      } else {
+        c.bits = a.as_bits();
+        const auto other = b.as_bits();
+        for (std::uint32_t w{0}; w < words; ++w)
+          c.bits[w] |= other[w];
+      }
+      c.normalize();
+      return c;
+    }
+  };
+
+  std::vector<Container> containers; ///< Блоки по возрастанию key
+};
+
+/**
+ * @brief Битовые индексы по столбцам подразделения и должности
+ *
+ * Для каждого кода словаря хранится набор строк с этим кодом, поэтому
+ * фильтры вида "подразделение = A и должность из {B, C}" и их счётчики
+ * вычисляются операциями над наборами, без обращения к строкам.
+ */
+struct SoldierBitmaps {
+  std::uint32_t rows{0};    ///< Число строк датасета
+  std::vector<Bitmap> unit; ///< Набор строк для каждого кода подразделения
+  std::vector<Bitmap> job;  ///< Набор строк для каждого кода должности
+
+  /// Занимаемая память в байтах
+  std::size_t bytes() const {
+    std::size_t n{0};
+    for (const auto &b : unit)
+      n += b.bytes();
+    for (const auto &b : job)
+      n += b.bytes();
+    return n;
+  }
+};
+
+/**
+ * @brief Построить битовые индексы по столбцовому датасету
+ * @param cols столбцовый датасет
+ */
+inline SoldierBitmaps build_bitmaps(const SoldierColumns &cols) {
+  SoldierBitmaps index;
+  index.rows = static_cast<std::uint32_t>(cols.size());
+  index.unit.resize(cols.units.values.size());
+  index.job.resize(cols.jobs.values.size());
+  for (std::uint32_t r{0}; r < cols.size(); ++r) {
+    index.unit[cols.unit[r]].push_back(r);
+    index.job[cols.job[r]].push_back(r);
+  }
+  return index;
+}
+
+/// Столбцовый датасет вместе с битовыми индексами по нему
+struct IndexedColumns {
+  SoldierColumns cols;    ///< Датасет
+  SoldierBitmaps bitmaps; ///< Индексы по подразделению и должности
+};
+
+namespace detail {
+
+/**
+ * @brief Переставить наборы строк вслед за перенумерацией кодов словаря
+ * @param sets наборы по старым кодам
+ * @param old_values строки словаря по старым кодам (до finalize())
+ * @param dict словарь после finalize()
+ */
+inline void remap_bitmaps(std::vector<Bitmap> &sets,
+                          const std::vector<std::string> &old_values,
+                          const Dictionary &dict) {
+  std::vector<Bitmap> remapped(sets.size());
+  for (std::size_t code{0}; code < sets.size(); ++code)
+    remapped[dict.index.at(old_values[code])] = std::move(sets[code]);
+  sets = std::move(remapped);
+}
+
+} // namespace detail
+
+/**
+ * @brief Считать датасет в столбцы, строя битовые индексы при загрузке
+ *
+ * Номер каждой строки добавляется в наборы её подразделения и должности
+ * сразу при разборе, так что отдельного прохода build_bitmaps() по
+ * столбцам не нужно. После чтения коды словарей упорядочиваются, как в
+ * read_columns(), и наборы переставляются вслед за ними.
+ *
+ * @param filename Имя датасета
+ * @return Датасет и индексы по нему
+ */
+inline IndexedColumns read_indexed_columns(const std::string &filename) {
+  IndexedColumns out;
+  auto &cols = out.cols;
+  auto &index = out.bitmaps;
+  std::ifstream ifile(filename);
+  std::string line;
+
+  if (!ifile.is_open()) {
+    std::cerr << "read_indexed_columns: Couldn't open file\n";
+  }
+
+  while (std::getline(ifile, line)) {
+    std::vector<std::string> fields_v = split(line, ',');
+    const auto row = static_cast<std::uint32_t>(cols.size());
+    const auto job = cols.jobs.encode(fields_v[1]);
+    const auto unit = cols.units.encode(fields_v[2]);
+    if (job >= index.job.size())
+      index.job.resize(job + 1);
+    if (unit >= index.unit.size())
+      index.unit.resize(unit + 1);
+    index.job[job].push_back(row);
+    index.unit[unit].push_back(row);
+
+    cols.full_name.push_back(std::move(fields_v[0]));
+    cols.job.push_back(job);
+    cols.unit.push_back(unit);
+    cols.salary.push_back(std::stoi(fields_v[3]));
+  }
+  index.rows = static_cast<std::uint32_t>(cols.size());
+
+  const auto jobs = cols.jobs.values, units = cols.units.values;
+  cols.finalize();
+  detail::remap_bitmaps(index.job, jobs, cols.jobs);
+  detail::remap_bitmaps(index.unit, units, cols.units);
+  return out;
+}
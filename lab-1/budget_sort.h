@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>   // std::sort, std::min, std::max
+#include <cstdio>      // std::remove
+#include <cstdint>     // std::uint32_t
+#include <fstream>     // std::ifstream, std::ofstream
+#include <iostream>    // std::cerr
+#include <numeric>     // std::iota
+#include <string>      // std::string, std::getline
+#include <string_view> // std::string_view
+#include <vector>      // std::vector
+
+#include "columns.h" // Dictionary
+#include "metrics.h" // lab_metrics
+#include "runs.h"    // make_runs, merge_runs, reduce_runs
+#include "soldier.h" // estimate_dataset, write_row
+#include "sorts.h"   // merge_sort
+
+/**
+ * @brief Компактное представление датасета для сортировки в малой памяти
+ *
+ * ФИО лежат подряд в одной строке (без заголовков std::string и
+ * выделения памяти на каждую), должность и подразделение - кодами
+ * словарей с сохранением порядка. На строку приходится 16 байт плюс
+ * длина ФИО, тогда как std::vector<Soldier> тратит не меньше 104 байт
+ * плюс длинные строки в куче.
+ */
+struct CompactRows {
+  std::string names;                   ///< ФИО всех строк подряд
+  std::vector<std::uint32_t> name_end; ///< Конец ФИО строки в names
+  std::vector<std::uint32_t> job;      ///< Коды должностей (см. jobs)
+  std::vector<std::uint32_t> unit;     ///< Коды подразделений (см. units)
+  std::vector<int> salary;             ///< Зарплата
+  Dictionary jobs;                     ///< Словарь должностей
+  Dictionary units;                    ///< Словарь подразделений
+
+  /// Число строк
+  std::size_t size() const { return salary.size(); }
+
+  /// ФИО строки r
+  std::string_view full_name(std::size_t r) const {
+    const std::uint32_t begin = r == 0 ? 0 : name_end[r - 1];
+    return std::string_view(names).substr(begin, name_end[r] - begin);
+  }
+
+  /// Сравнение строк в порядке operator<(Soldier, Soldier)
+  bool less(std::uint32_t a, std::uint32_t b) const {
+    if (unit[a] != unit[b])
+      return unit[a] < unit[b];
+    const auto na = full_name(a), nb = full_name(b);
+    if (na != nb)
+      return na < nb;
+    return salary[a] < salary[b];
+  }
+};
+
+/// Память под CompactRows по оценке (без словарей - они малы)
+inline std::size_t compact_bytes(const DatasetEstimate &e) {
+  return e.name_bytes + e.rows * 4 * sizeof(std::uint32_t);
+}
+
+/**
+ * @brief Загрузить датасет в CompactRows
+ *
+ * Память резервируется по оценке estimate с запасом 10%, чтобы
+ * удвоение ёмкости при росте не превысило ограничение.
+ *
+ * @param filename имя датасета
+ * @param estimate оценка размеров (см. estimate_dataset)
+ */
+inline CompactRows read_compact(const std::string &filename,
+                                const DatasetEstimate &estimate) {
+  CompactRows rows;
+  rows.names.reserve(estimate.name_bytes * 11 / 10);
+  const std::size_t n = estimate.rows * 11 / 10;
+  rows.name_end.reserve(n);
+  rows.job.reserve(n);
+  rows.unit.reserve(n);
+  rows.salary.reserve(n);
+
+  std::ifstream ifile(filename);
+  if (!ifile.is_open()) {
+    std::cerr << "read_compact: Couldn't open file\n";
+    return rows;
+  }
+  std::string line, field;
+  std::uint64_t bytes{0};
+  while (std::getline(ifile, line)) {
+    bytes += line.size() + 1;
+    std::string_view rest(line);
+    std::string_view fields[3];
+    for (auto &f : fields) {
+      const auto comma = rest.find(',');
+      f = rest.substr(0, comma);
+      rest.remove_prefix(comma + 1);
+    }
+    rows.names.append(fields[0]);
+    rows.name_end.push_back(static_cast<std::uint32_t>(rows.names.size()));
+    rows.job.push_back(rows.jobs.encode(field.assign(fields[1])));
+    rows.unit.push_back(rows.units.encode(field.assign(fields[2])));
+    rows.salary.push_back(std::stoi(std::string(rest)));
+  }
+  rows.jobs.finalize(rows.job);
+  rows.units.finalize(rows.unit);
+  lab_metrics().rows_parsed.add(rows.size());
+  lab_metrics().bytes_read.add(bytes);
+  return rows;
+}
+
+/// Способ сортировки при ограничении памяти
+enum class SortPlan {
+  buffered, ///< CompactRows + merge_sort номеров строк (буфер n/2)
+  in_place, ///< CompactRows + std::sort номеров строк (без буфера)
+  external  ///< Отрезки на диске (make_runs) и многопутевое слияние
+};
+
+/// Название способа сортировки
+inline const char *plan_name(SortPlan plan) {
+  switch (plan) {
+  case SortPlan::buffered:
+    return "buffered";
+  case SortPlan::in_place:
+    return "in_place";
+  default:
+    return "external";
+  }
+}
+
+/**
+ * @brief Выбрать способ сортировки, укладывающийся в память
+ * @param e оценка размеров датасета
+ * @param limit ограничение памяти в байтах
+ */
+inline SortPlan plan_sort(const DatasetEstimate &e, std::size_t limit) {
+  const std::size_t base =
+      (compact_bytes(e) + e.rows * sizeof(std::uint32_t)) * 11 / 10;
+  if (base + e.rows / 2 * sizeof(std::uint32_t) <= limit)
+    return SortPlan::buffered;
+  if (base <= limit)
+    return SortPlan::in_place;
+  return SortPlan::external;
+}
+
+/// Итоги сортировки с ограничением памяти
+struct BudgetSortStats {
+  SortPlan plan{SortPlan::buffered}; ///< Выбранный способ
+  std::size_t rows{0};               ///< Число строк
+  std::size_t runs{0};               ///< Число отрезков (для external)
+  std::size_t merge_passes{0};       ///< Число проходов слияния
+};
+
+/**
+ * @brief Отсортировать датасет, не выходя за ограничение памяти
+ *
+ * Способ выбирается по оценке размеров (plan_sort): при достаточной
+ * памяти датасет загружается в CompactRows и сортируются номера строк
+ * (merge_sort или, если на буфер не хватает, std::sort на месте);
+ * иначе строятся отрезки выбором с замещением в половине памяти и
+ * сливаются. Если отрезков больше, чем помещается открытых одновременно,
+ * слияние идёт в несколько проходов через промежуточные отрезки.
+ *
+ * @param input входной датасет (.csv)
+ * @param output выходной файл (.csv)
+ * @param limit ограничение памяти в байтах
+ * @param prefix префикс временных файлов отрезков
+ */
+inline BudgetSortStats budget_sort(const std::string &input,
+                                   const std::string &output,
+                                   std::size_t limit,
+                                   const std::string &prefix) {
+  BudgetSortStats stats;
+  const DatasetEstimate estimate = estimate_dataset(input);
+  stats.plan = plan_sort(estimate, limit);
+
+  std::ofstream ofile(output);
+  if (!ofile.is_open()) {
+    std::cerr << "budget_sort: Couldn't open file\n";
+    return stats;
+  }
+
+  if (stats.plan != SortPlan::external) {
+    const CompactRows rows = read_compact(input, estimate);
+    std::vector<std::uint32_t> order(rows.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto less = [&](std::uint32_t a, std::uint32_t b) {
+      return rows.less(a, b);
+    };
+    if (stats.plan == SortPlan::buffered)
+      merge_sort(order.begin(), order.end(), less);
+    else
+      std::sort(order.begin(), order.end(), less);
+
+    for (auto r : order) {
+      ofile << rows.full_name(r) << ',' << rows.jobs.values[rows.job[r]]
+            << ',' << rows.units.values[rows.unit[r]] << ','
+            << rows.salary[r] << '\n';
+    }
+    stats.rows = rows.size();
+  } else {
+    const RunStats runs = make_runs(input, prefix, limit / 2);
+    stats.runs = runs.files.size();
+    const std::size_t fan_in =
+        std::max<std::size_t>(2, limit / 2 / run_reader_bytes);
+
+    std::vector<std::string> files = runs.files;
+    stats.merge_passes = reduce_runs(files, fan_in, prefix);
+    merge_runs(files, [&](const Soldier &s) {
+      write_row(ofile, s);
+      ++stats.rows;
+    });
+    ++stats.merge_passes;
+    for (const auto &f : files)
+      std::remove(f.c_str());
+  }
+
+  ofile.flush();
+  const std::streamoff written = ofile.tellp();
+  lab_metrics().bytes_written.add(written > 0 ? written : 0);
+  return stats;
+}
@@ -0,0 +1,11 @@
+#!/bin/sh
+set -e
+mkdir -p build/
+g++ -std=c++20 -O2 -Wall -Wextra -fPIC -fvisibility=hidden -fvisibility-inlines-hidden -c lab1.cpp -o build/lab1.o
+g++ -shared -Wl,-soname,liblab1.so.1 build/lab1.o -o build/liblab1.so.1
+ln -sf liblab1.so.1 build/liblab1.so
+rm -f build/liblab1.a
+ar rcs build/liblab1.a build/lab1.o
+gcc -std=c99 -Wall -Wextra -pedantic lab1_check.c build/liblab1.a -lstdc++ -lm -pthread -o build/lab1_check_static
+gcc -std=c99 -Wall -Wextra -pedantic lab1_check.c -Lbuild -llab1 -Wl,-rpath,'$ORIGIN' -o build/lab1_check
+build/lab1_check_static build && build/lab1_check build
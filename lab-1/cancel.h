@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>  // std::atomic
+#include <chrono>  // std::chrono::steady_clock
+#include <cstdint> // std::uint32_t
+
+/**
+ * @brief Флаг отмены долгой операции с необязательным сроком
+ *
+ * Сортировки периодически вызывают stop_requested() и, получив true,
+ * возвращаются досрочно: контейнер остаётся перестановкой исходных
+ * данных, но не отсортирован. Срок проверяется по часам не при каждом
+ * вызове, а раз в poll_stride вызовов, поэтому проверка почти ничего
+ * не стоит даже в самых мелких шагах сортировки.
+ *
+ * stop_requested() вызывается из одного потока (того, что выполняет
+ * операцию), отменить её можно из любого через cancel().
+ */
+class CancelToken {
+public:
+  using clock = std::chrono::steady_clock;
+
+  /// Токен без срока: операция отменяется только через cancel()
+  CancelToken() = default;
+
+  /// Токен, срабатывающий через budget после создания
+  explicit CancelToken(clock::duration budget)
+      : deadline(clock::now() + budget), has_deadline(true) {}
+
+  /// Запросить отмену
+  void cancel() { flag.store(true, std::memory_order_relaxed); }
+
+  /// Запрошена ли отмена (или истёк срок)
+  bool stop_requested() const {
+    if (flag.load(std::memory_order_relaxed))
+      return true;
+    if (has_deadline && ++polls % poll_stride == 0 && clock::now() > deadline) {
+      flag.store(true, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  /// Вернул ли stop_requested() true хотя бы раз (операция прервана)
+  bool stopped() const { return flag.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr std::uint32_t poll_stride = 32;
+  mutable std::atomic<bool> flag{false};
+  mutable std::uint32_t polls{0};
+  clock::time_point deadline{};
+  bool has_deadline{false};
+};
+
+/// Проверка необязательного токена: nullptr - отмены не бывает
+inline bool cancelled(const CancelToken *token) {
+  return token != nullptr && token->stop_requested();
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>     // std::sort
+#include <cstdint>       // std::uint32_t
+#include <fstream>       // std::ifstream, std::ofstream
+#include <iostream>      // std::cerr
+#include <numeric>       // std::iota
+#include <optional>      // std::optional
+#include <string>        // std::string, std::getline
+#include <thread>        // std::thread
+#include <unordered_map> // std::unordered_map
+#include <vector>        // std::vector
+
+#include "soldier.h" // Soldier, split
+#include "sorts.h"   // merge_sort
+
+/**
+ * @brief Словарь строковых значений столбца
+ *
+ * Каждой различной строке сопоставляется код. После вызова finalize()
+ * коды упорядочены так же, как сами строки, поэтому сравнение кодов
+ * эквивалентно сравнению строк.
+ */
+struct Dictionary {
+  std::vector<std::string> values;                       ///< Код -> строка
+  std::unordered_map<std::string, std::uint32_t> index; ///< Строка -> код
+
+  /**
+   * @brief Получить код строки, добавив её в словарь при необходимости
+   * @param s строка
+   * @return код строки
+   */
+  std::uint32_t encode(const std::string &s) {
+    auto [it, inserted] =
+        index.try_emplace(s, static_cast<std::uint32_t>(values.size()));
+    if (inserted) {
+      values.push_back(s);
+    }
+    return it->second;
+  }
+
+  /**
+   * @brief Перенумеровать коды в порядке возрастания строк
+   * @param codes столбец кодов, который нужно перекодировать
+   */
+  void finalize(std::vector<std::uint32_t> &codes) {
+    std::vector<std::uint32_t> order(values.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&](auto a, auto b) { return values[a] < values[b]; });
+
+    std::vector<std::uint32_t> remap(values.size());
+    std::vector<std::string> sorted;
+    sorted.reserve(values.size());
+    for (std::uint32_t i{0}; i < order.size(); ++i) {
+      remap[order[i]] = i;
+      sorted.push_back(std::move(values[order[i]]));
+    }
+    values = std::move(sorted);
+    for (auto &[s, code] : index) {
+      code = remap[code];
+    }
+    for (auto &c : codes) {
+      c = remap[c];
+    }
+  }
+};
+
+/**
+ * @brief Датасет военнослужащих в столбцовом представлении
+ *
+ * Подразделение и должность хранятся кодами словарей (их всего
+ * несколько десятков различных), ФИО и зарплата - как есть.
+ */
+struct SoldierColumns {
+  std::vector<std::string> full_name; ///< ФИО
+  std::vector<std::uint32_t> job;     ///< Коды должностей (см. jobs)
+  std::vector<std::uint32_t> unit;    ///< Коды подразделений (см. units)
+  std::vector<int> salary;            ///< Зарплата
+  Dictionary jobs;                    ///< Словарь должностей
+  Dictionary units;                   ///< Словарь подразделений
+
+  /// Число строк
+  std::size_t size() const { return salary.size(); }
+
+  /// Восстановить строку датасета по номеру
+  Soldier row(std::size_t i) const {
+    return Soldier(full_name[i], jobs.values[job[i]], units.values[unit[i]],
+                   salary[i]);
+  }
+
+  /// Добавить строку в конец
+  void push_back(const Soldier &s) {
+    full_name.push_back(s.full_name);
+    job.push_back(jobs.encode(s.job));
+    unit.push_back(units.encode(s.unit));
+    salary.push_back(s.salary);
+  }
+
+  /// Упорядочить коды словарей (вызывается после загрузки)
+  void finalize() {
+    jobs.finalize(job);
+    units.finalize(unit);
+  }
+};
+
+/**
+ * @brief Считать датасет военнослужащих сразу в столбцы
+ * @param filename Имя датасета (например, "dataset_1.csv")
+ * @return Столбцовое представление датасета
+ */
+inline SoldierColumns read_columns(const std::string &filename) {
+  SoldierColumns cols;
+  std::ifstream ifile(filename);
+  std::string line;
+
+  if (!ifile.is_open()) {
+    std::cerr << "read_columns: Couldn't open file\n";
+  }
+
+  while (std::getline(ifile, line)) {
+    std::vector<std::string> fields_v = split(line, ',');
+    cols.full_name.push_back(std::move(fields_v[0]));
+    cols.job.push_back(cols.jobs.encode(fields_v[1]));
+    cols.unit.push_back(cols.units.encode(fields_v[2]));
+    cols.salary.push_back(std::stoi(fields_v[3]));
+  }
+
+  cols.finalize();
+  return cols;
+}
+
+/**
+ * @brief Перевести вектор объектов в столбцовое представление
+ * @param data вектор объектов
+ * @return Столбцовое представление
+ */
+inline SoldierColumns to_columns(const std::vector<Soldier> &data) {
+  SoldierColumns cols;
+  for (const auto &s : data) {
+    cols.push_back(s);
+  }
+  cols.finalize();
+  return cols;
+}
+
+/// Поле Soldier, участвующее в ключе сортировки
+enum class Field { full_name, job, unit, salary };
+
+/// Ключ сортировки: список полей в порядке приоритета
+using OrderingKey = std::vector<Field>;
+
+/**
+ * @brief Разобрать ключ сортировки вида "unit,full_name,salary"
+ * @param spec список полей через запятую
+ * @return Ключ либо std::nullopt, если встретилось неизвестное поле
+ */
+inline std::optional<OrderingKey> parse_ordering(const std::string &spec) {
+  OrderingKey key;
+  for (const auto &name : split(spec, ',')) {
+    if (name == "full_name")
+      key.push_back(Field::full_name);
+    else if (name == "job")
+      key.push_back(Field::job);
+    else if (name == "unit")
+      key.push_back(Field::unit);
+    else if (name == "salary")
+      key.push_back(Field::salary);
+    else
+      return std::nullopt;
+  }
+  if (key.empty()) {
+    return std::nullopt;
+  }
+  return key;
+}
+
+/**
+ * @brief Сравнить две строки столбцового датасета по ключу
+ * @return true, если строка a меньше строки b
+ */
+inline bool row_less(const SoldierColumns &cols, const OrderingKey &key,
+                     std::uint32_t a, std::uint32_t b) {
+  for (Field f : key) {
+    switch (f) {
+    case Field::full_name:
+      if (int c = cols.full_name[a].compare(cols.full_name[b]); c != 0)
+        return c < 0;
+      break;
+    case Field::job:
+      if (cols.job[a] != cols.job[b])
+        return cols.job[a] < cols.job[b];
+      break;
+    case Field::unit:
+      if (cols.unit[a] != cols.unit[b])
+        return cols.unit[a] < cols.unit[b];
+      break;
+    case Field::salary:
+      if (cols.salary[a] != cols.salary[b])
+        return cols.salary[a] < cols.salary[b];
+      break;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Построить перестановку строк, упорядочивающую датасет по ключу
+ *
+ * Сами столбцы не перемещаются, сортируется только вектор номеров строк.
+ *
+ * @param cols столбцовый датасет
+ * @param key ключ сортировки
+ * @return Номера строк в порядке возрастания ключа
+ */
+inline std::vector<std::uint32_t> build_permutation(const SoldierColumns &cols,
+                                                    const OrderingKey &key) {
+  std::vector<std::uint32_t> perm(cols.size());
+  std::iota(perm.begin(), perm.end(), 0);
+  if (perm.size() > 1) {
+    merge_sort(perm.begin(), perm.end(), [&](auto a, auto b) {
+      return row_less(cols, key, a, b);
+    });
+  }
+  return perm;
+}
+
+/**
+ * @brief Построить несколько упорядочений одного датасета параллельно
+ *
+ * Каждая перестановка строится в своём потоке; столбцы и словари
+ * разделяются между потоками только на чтение.
+ *
+ * @param cols столбцовый датасет
+ * @param keys ключи сортировки
+ * @return Перестановки, по одной на каждый ключ
+ */
+inline std::vector<std::vector<std::uint32_t>>
+build_orderings(const SoldierColumns &cols,
+                const std::vector<OrderingKey> &keys) {
+  std::vector<std::vector<std::uint32_t>> perms(keys.size());
+  std::vector<std::thread> workers;
+  for (std::size_t i{0}; i < keys.size(); ++i) {
+    workers.emplace_back(
+        [&, i] { perms[i] = build_permutation(cols, keys[i]); });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  return perms;
+}
+
+/**
+ * @brief Записать столбцовый датасет в .csv файл в порядке перестановки
+ * @param filename имя файла
+ * @param cols столбцовый датасет
+ * @param perm порядок строк
+ */
+inline void write_csv(const std::string &filename, const SoldierColumns &cols,
+                      const std::vector<std::uint32_t> &perm) {
+  std::ofstream ofile(filename);
+  if (!ofile.is_open()) {
+    std::cerr << "write_csv: Couldn't open file\n";
+  }
+  for (auto i : perm) {
+    ofile << cols.full_name[i] << ',' << cols.jobs.values[cols.job[i]] << ','
+          << cols.units.values[cols.unit[i]] << ',' << cols.salary[i] << '\n';
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>  // std::sort
+#include <cstdint>    // std::uintmax_t
+#include <filesystem> // std::filesystem::file_size
+#include <numeric>    // std::iota
+#include <string>     // std::string
+#include <vector>     // std::vector
+
+#include "direct_io.h" // IoMode, read_csv
+#include "scheduler.h" // Scheduler, TaskGroup
+#include "soldier.h"   // Soldier
+
+/**
+ * @brief Считать и разобрать несколько датасетов параллельно
+ *
+ * Каждый файл - отдельная задача планировщика. Задачи ставятся от
+ * большего файла к меньшему: общая очередь планировщика раздаётся по
+ * порядку, поэтому самые долгие чтения начинаются первыми, а мелкие
+ * заполняют оставшиеся промежутки (жадное LPT-расписание). Общее время
+ * при достаточном числе потоков близко ко времени чтения самого
+ * большого файла.
+ *
+ * @param sched планировщик
+ * @param filenames имена датасетов
+ * @param io способ чтения (см. IoMode)
+ * @return Датасеты в порядке filenames
+ */
+inline std::vector<std::vector<Soldier>>
+load_datasets(Scheduler &sched, const std::vector<std::string> &filenames,
+              IoMode io = IoMode::buffered) {
+  std::vector<std::uintmax_t> sizes(filenames.size(), 0);
+  for (std::size_t f{0}; f < filenames.size(); ++f) {
+    std::error_code ec;
+    sizes[f] = std::filesystem::file_size(filenames[f], ec);
+  }
+  std::vector<std::size_t> order(filenames.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](std::size_t a, std::size_t b) { return sizes[a] > sizes[b]; });
+
+  std::vector<std::vector<Soldier>> datasets(filenames.size());
+  TaskGroup group(sched);
+  for (auto f : order)
+    group.run([&, f] { datasets[f] = read_csv(filenames[f], io); });
+  group.wait();
+  return datasets;
+}
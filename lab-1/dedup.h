@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>    // std::uint32_t, std::uint64_t
+#include <functional> // std::hash
+#include <string>     // std::string
+#include <vector>     // std::vector
+
+#include "setops.h"  // RecordLess, KeyLess
+#include "soldier.h" // Soldier
+#include "sorts.h"   // merge_sort_unique
+
+/// Что считать повтором строки
+enum class DedupKey {
+  exact, ///< совпадают все поля
+  key    ///< совпадает ключ (подразделение, ФИО, должность)
+};
+
+/// Способ удаления повторов
+enum class DedupStrategy {
+  sort, ///< повторы отбрасываются на последнем слиянии merge_sort
+  hash  ///< хеш-множество с открытой адресацией
+};
+
+/**
+ * @brief Хеш строки датасета по полям, определяющим повтор
+ * @param s строка
+ * @param mode что считать повтором
+ */
+inline std::uint64_t record_hash(const Soldier &s, DedupKey mode) {
+  std::hash<std::string> h;
+  std::uint64_t x = h(s.unit);
+  x = (x ^ h(s.full_name)) * 0x9e3779b97f4a7c15ULL;
+  x = (x ^ h(s.job)) * 0x9e3779b97f4a7c15ULL;
+  if (mode == DedupKey::exact) {
+    x = (x ^ static_cast<std::uint64_t>(s.salary)) * 0x9e3779b97f4a7c15ULL;
+  }
+  return x ^ (x >> 32);
+}
+
+/**
+ * @brief Являются ли две строки повторами друг друга
+ * @param mode что считать повтором
+ */
+inline bool same_record(const Soldier &a, const Soldier &b, DedupKey mode) {
+  return a.unit == b.unit && a.full_name == b.full_name && a.job == b.job &&
+         (mode == DedupKey::key || a.salary == b.salary);
+}
+
+/**
+ * @brief Удалить повторы сортировкой
+ *
+ * Результат упорядочен (по RecordLess или KeyLess в зависимости от mode).
+ * Из группы повторов по ключу остаётся одна произвольная строка.
+ *
+ * @param data датасет, изменяется на месте
+ * @param mode что считать повтором
+ */
+inline void dedup_sort(std::vector<Soldier> &data, DedupKey mode) {
+  auto last = mode == DedupKey::exact
+                  ? merge_sort_unique(data.begin(), data.end(), RecordLess())
+                  : merge_sort_unique(data.begin(), data.end(), KeyLess());
+  data.erase(last, data.end());
+}
+
+/**
+ * @brief Удалить повторы хеш-множеством
+ *
+ * Хеши всех строк вычисляются заранее одним проходом. Таблица хранит
+ * номера строк (открытая адресация, линейное пробирование, заполнение
+ * не больше половины); строки сравниваются только при совпадении хешей.
+ * Сохраняется первое вхождение и исходный порядок строк.
+ *
+ * @param data датасет, изменяется на месте
+ * @param mode что считать повтором
+ */
+inline void dedup_hash(std::vector<Soldier> &data, DedupKey mode) {
+  constexpr std::uint32_t empty = ~std::uint32_t{0};
+
+  std::vector<std::uint64_t> hashes(data.size());
+  for (std::size_t i{0}; i < data.size(); ++i) {
+    hashes[i] = record_hash(data[i], mode);
+  }
+
+  std::size_t capacity{16};
+  while (capacity < 2 * data.size()) {
+    capacity *= 2;
+  }
+  const std::size_t mask = capacity - 1;
+  std::vector<std::uint32_t> table(capacity, empty);
+
+  std::size_t kept{0};
+  for (std::size_t i{0}; i < data.size(); ++i) {
+    std::size_t pos = hashes[i] & mask;
+    bool duplicate = false;
+    for (; table[pos] != empty; pos = (pos + 1) & mask) {
+      const auto k = table[pos];
+      if (hashes[k] == hashes[i] && same_record(data[k], data[i], mode)) {
+        duplicate = true;
+        break;
+      }
+    }
+    if (duplicate) {
+      continue;
+    }
+    if (kept != i) {
+      data[kept] = std::move(data[i]);
+      hashes[kept] = hashes[i];
+    }
+    table[pos] = static_cast<std::uint32_t>(kept);
+    ++kept;
+  }
+  data.erase(data.begin() + kept, data.end());
+}
+
+/**
+ * @brief Выбрать способ удаления повторов
+ *
+ * Если результат всё равно нужно упорядочить, повторы бесплатно
+ * отбрасываются при сортировке. Маленькие датасеты тоже проще
+ * отсортировать, чем заводить таблицу. В остальных случаях хеширование
+ * линейно и не перемещает строки.
+ *
+ * @param n число строк
+ * @param need_sorted нужен ли упорядоченный результат
+ */
+inline DedupStrategy choose_dedup(std::size_t n, bool need_sorted) {
+  if (need_sorted || n < 256) {
+    return DedupStrategy::sort;
+  }
+  return DedupStrategy::hash;
+}
+
+/**
+ * @brief Удалить повторы способом, выбранным choose_dedup()
+ * @param data датасет, изменяется на месте
+ * @param mode что считать повтором
+ * @param need_sorted нужен ли упорядоченный результат
+ */
+inline void dedup(std::vector<Soldier> &data, DedupKey mode,
+                  bool need_sorted = false) {
+  if (choose_dedup(data.size(), need_sorted) == DedupStrategy::sort) {
+    dedup_sort(data, mode);
+  } else {
+    dedup_hash(data, mode);
+  }
+}
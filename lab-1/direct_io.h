@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>   // std::min
+#include <atomic>      // std::atomic
+#include <cerrno>      // errno, EINVAL, EINTR, EIO
+#include <charconv>    // std::from_chars
+#include <cstdlib>     // std::aligned_alloc, std::free
+#include <cstring>     // std::memcpy, std::memset
+#include <iostream>    // std::cerr
+#include <memory>      // std::unique_ptr
+#include <string>      // std::string, std::to_string
+#include <string_view> // std::string_view
+#include <thread>      // std::thread
+#include <vector>      // std::vector
+
+#include <fcntl.h>    // open, O_DIRECT, posix_fadvise
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // pread, pwrite, close, ftruncate
+
+#include "metrics.h" // lab_metrics
+#include "soldier.h" // Soldier, read_csv, write_csv
+#include "trace.h"   // LAB1_PROBE1, LAB1_PROBE2
+
+/// Способ чтения и записи датасетов
+enum class IoMode {
+  buffered, ///< через std::ifstream/std::ofstream и кэш страниц
+  direct    ///< O_DIRECT, мимо кэша страниц
+};
+
+/// Выравнивание буферов и смещений для O_DIRECT
+inline constexpr std::size_t io_align = 4096;
+
+/// Размер одного запроса чтения
+inline constexpr std::size_t io_chunk = std::size_t{1} << 20;
+
+/// Буфер, выровненный по io_align
+struct AlignedBuffer {
+  struct Free {
+    void operator()(char *p) const { std::free(p); }
+  };
+  std::unique_ptr<char, Free> data; ///< Память
+  std::size_t size{0};              ///< Размер (кратен io_align)
+
+  explicit AlignedBuffer(std::size_t n)
+      : size(std::max(io_align, (n + io_align - 1) / io_align * io_align)) {
+    data.reset(static_cast<char *>(std::aligned_alloc(io_align, size)));
+  }
+};
+
+/**
+ * @brief Вытеснить файл из кэша страниц
+ *
+ * Используется, чтобы замер чтения был "холодным"; на изменённые
+ * (ещё не записанные) страницы не действует.
+ */
+inline void drop_page_cache(const std::string &filename) {
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  ::fdatasync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+/**
+ * @brief Прочитать файл целиком мимо кэша страниц
+ *
+ * Файл делится на куски по io_chunk, которые читаются pread из
+ * queue_depth потоков одновременно, так что у устройства всегда есть
+ * несколько запросов в очереди. Если файловая система не поддерживает
+ * O_DIRECT, файл читается обычным образом и затем вытесняется из кэша.
+ * Прерванный сигналом pread (EINTR) повторяется; ошибка чтения или
+ * конец файла раньше его размера в любом потоке останавливает чтение
+ * и даёт пустой результат, а не буфер с нулями на месте непрочитанного.
+ *
+ * @param filename имя файла
+ * @param queue_depth число одновременных запросов
+ * @return Содержимое файла (пустое при ошибке)
+ */
+inline std::string read_file_direct(const std::string &filename,
+                                    unsigned queue_depth = 4) {
+  bool direct = true;
+  int fd = ::open(filename.c_str(), O_RDONLY | O_DIRECT);
+  if (fd < 0 && errno == EINVAL) {
+    direct = false;
+    fd = ::open(filename.c_str(), O_RDONLY);
+  }
+  if (fd < 0) {
+    std::cerr << "read_file_direct: Couldn't open file\n";
+    return {};
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    std::cerr << "read_file_direct: Couldn't read file\n";
+    ::close(fd);
+    return {};
+  }
+  const auto size = static_cast<std::size_t>(st.st_size);
+  AlignedBuffer buffer(size);
+
+  // errno первой ошибки любого потока (EIO - файл кончился раньше size)
+  std::atomic<int> error{0};
+  const std::size_t chunks = (size + io_chunk - 1) / io_chunk;
+  std::vector<std::thread> workers;
+  for (unsigned q{0}; q < std::max(1u, queue_depth); ++q) {
+    workers.emplace_back([&, q] {
+      for (std::size_t c = q; c < chunks && error.load() == 0;
+           c += std::max(1u, queue_depth)) {
+        const std::size_t offset = c * io_chunk;
+        const std::size_t len =
+            std::min(io_chunk, buffer.size - offset) / io_align * io_align;
+        std::size_t done{0};
+        // Длина последнего куска выровнена вверх: короткое чтение в
+        // конце файла - не ошибка
+        while (done < len && offset + done < size) {
+          const auto got = ::pread(fd, buffer.data.get() + offset + done,
+                                   len - done, offset + done);
+          if (got < 0 && errno == EINTR)
+            continue;
+          if (got <= 0) {
+            int none{0};
+            error.compare_exchange_strong(none, got < 0 ? errno : EIO);
+            break;
+          }
+          done += got;
+        }
+      }
+    });
+  }
+  for (auto &w : workers)
+    w.join();
+
+  if (!direct)
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+  if (error.load() != 0) {
+    std::cerr << "read_file_direct: Couldn't read file\n";
+    return {};
+  }
+  lab_metrics().bytes_read.add(size);
+  return std::string(buffer.data.get(), size);
+}
+
+/**
+ * @brief Записать данные в файл мимо кэша страниц
+ *
+ * Данные копируются в выровненный буфер, дополняются нулями до
+ * кратного io_align размера и пишутся кусками по io_chunk; лишний
+ * хвост затем отрезается ftruncate. Прерванный сигналом pwrite (EINTR)
+ * повторяется; при ошибке записи или ftruncate файл может остаться
+ * обрезанным или с нулями в хвосте, поэтому результат нужно проверять.
+ *
+ * @param filename имя файла
+ * @param text содержимое
+ * @return true, если файл записан целиком
+ */
+inline bool write_file_direct(const std::string &filename,
+                              std::string_view text) {
+  bool direct = true;
+  int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT,
+                  0644);
+  if (fd < 0 && errno == EINVAL) {
+    direct = false;
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+  if (fd < 0) {
+    std::cerr << "write_file_direct: Couldn't open file\n";
+    return false;
+  }
+
+  AlignedBuffer buffer(text.size());
+  std::memcpy(buffer.data.get(), text.data(), text.size());
+  std::memset(buffer.data.get() + text.size(), 0, buffer.size - text.size());
+
+  bool written = true;
+  for (std::size_t offset{0}; written && offset < buffer.size;) {
+    const auto put =
+        ::pwrite(fd, buffer.data.get() + offset,
+                 std::min(io_chunk, buffer.size - offset), offset);
+    if (put < 0 && errno == EINTR)
+      continue;
+    if (put <= 0)
+      written = false;
+    else
+      offset += put;
+  }
+  written = written && ::ftruncate(fd, text.size()) == 0;
+  if (!direct) {
+    written = written && ::fdatasync(fd) == 0;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  }
+  ::close(fd);
+
+  if (!written) {
+    std::cerr << "write_file_direct: Couldn't write file\n";
+    return false;
+  }
+  lab_metrics().bytes_written.add(text.size());
+  return true;
+}
+
+/**
+ * @brief Разобрать содержимое .csv файла, уже находящееся в памяти
+ * @param text содержимое файла
+ * @return Вектор объектов
+ */
+inline std::vector<Soldier> parse_csv(std::string_view text) {
+  std::vector<Soldier> data;
+  while (!text.empty()) {
+    auto eol = text.find('\n');
+    auto line = text.substr(0, eol);
+    text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+    if (line.empty())
+      continue;
+
+    std::string_view fields[4];
+    for (int f{0}; f < 3; ++f) {
+      const auto comma = line.find(',');
+      fields[f] = line.substr(0, comma);
+      line.remove_prefix(comma + 1);
+    }
+    fields[3] = line;
+    int salary{0};
+    std::from_chars(fields[3].data(), fields[3].data() + fields[3].size(),
+                    salary);
+    data.emplace_back(std::string(fields[0]), std::string(fields[1]),
+                      std::string(fields[2]), salary);
+  }
+  lab_metrics().rows_parsed.add(data.size());
+  return data;
+}
+
+/**
+ * @brief Считать датасет выбранным способом
+ * @param filename Имя датасета
+ * @param mode способ чтения
+ */
+inline std::vector<Soldier> read_csv(const std::string &filename,
+                                     IoMode mode) {
+  if (mode == IoMode::buffered)
+    return read_csv(filename);
+  LAB1_PROBE1(read_csv_start, filename.c_str());
+  auto data = parse_csv(read_file_direct(filename));
+  LAB1_PROBE2(read_csv_end, filename.c_str(), data.size());
+  return data;
+}
+
+/**
+ * @brief Записать датасет выбранным способом
+ * @param filename имя файла
+ * @param data вектор объектов
+ * @param mode способ записи
+ * @return true, если файл записан
+ */
+inline bool write_csv(const std::string &filename,
+                      const std::vector<Soldier> &data, IoMode mode) {
+  if (mode == IoMode::buffered)
+    return write_csv(filename, data);
+  LAB1_PROBE2(write_csv_start, filename.c_str(), data.size());
+  std::string text;
+  for (const auto &v : data) {
+    text += v.full_name;
+    text += ',';
+    text += v.job;
+    text += ',';
+    text += v.unit;
+    text += ',';
+    text += std::to_string(v.salary);
+    text += '\n';
+  }
+  const bool written = write_file_direct(filename, text);
+  LAB1_PROBE2(write_csv_end, filename.c_str(), data.size());
+  return written;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>    // std::uint64_t
+#include <filesystem> // std::filesystem::directory_iterator
+#include <fstream>    // std::ifstream
+#include <string>     // std::string
+#include <vector>     // std::vector
+
+/**
+ * @brief Счётчики энергии RAPL через интерфейс powercap Linux
+ *
+ * Читаются зоны верхнего уровня /sys/class/powercap/intel-rapl:N
+ * (пакеты процессора; подзоны core/uncore/dram входят в них или
+ * считаются отдельно и не суммируются). Зона psys охватывает всю
+ * платформу и включает пакеты, поэтому тоже пропускается. Счётчики
+ * energy_uj переполняются через max_energy_range_uj, что учитывается
+ * при вычитании.
+ *
+ * Если зон нет (виртуальная машина, не x86) или energy_uj недоступен
+ * для чтения (в новых ядрах - только root), available() возвращает
+ * false и замеры энергии не выводятся.
+ */
+class EnergyMeter {
+public:
+  /// @param root каталог интерфейса powercap
+  explicit EnergyMeter(const std::string &root = "/sys/class/powercap") {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    for (fs::directory_iterator it(root, ec), end; !ec && it != end;
+         it.increment(ec)) {
+      const std::string dir = it->path().filename().string();
+      if (dir.rfind("intel-rapl:", 0) != 0 ||
+          dir.find(':', sizeof("intel-rapl:") - 1) != std::string::npos) {
+        continue;
+      }
+      Zone zone{it->path().string() + "/energy_uj", 0};
+      if (read_value(it->path().string() + "/name") == "psys")
+        continue;
+      const std::string range =
+          read_value(it->path().string() + "/max_energy_range_uj");
+      zone.range = range.empty() ? 0 : std::stoull(range);
+      if (read_value(zone.path).empty())
+        continue;
+      zones.push_back(zone);
+    }
+  }
+
+  /// Есть ли хотя бы одна читаемая зона
+  bool available() const { return !zones.empty(); }
+
+  /// Показания всех зон (в микроджоулях)
+  std::vector<std::uint64_t> sample() const {
+    std::vector<std::uint64_t> values;
+    for (const auto &z : zones) {
+      const std::string v = read_value(z.path);
+      values.push_back(v.empty() ? 0 : std::stoull(v));
+    }
+    return values;
+  }
+
+  /**
+   * @brief Энергия между двумя замерами
+   * @param begin показания sample() до запуска
+   * @param end показания sample() после запуска
+   * @return Энергия в джоулях, суммарно по зонам
+   */
+  double joules(const std::vector<std::uint64_t> &begin,
+                const std::vector<std::uint64_t> &end) const {
+    std::uint64_t uj{0};
+    for (std::size_t z{0}; z < zones.size(); ++z) {
+      uj += end[z] >= begin[z] ? end[z] - begin[z]
+                               : zones[z].range - begin[z] + end[z];
+    }
+    return uj * 1e-6;
+  }
+
+private:
+  struct Zone {
+    std::string path;    ///< Путь к energy_uj
+    std::uint64_t range; ///< Значение, на котором счётчик переполняется
+  };
+  std::vector<Zone> zones;
+
+  static std::string read_value(const std::string &path) {
+    std::ifstream ifile(path);
+    std::string value;
+    ifile >> value;
+    return value;
+  }
+};
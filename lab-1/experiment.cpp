@@ -1,327 +1,1629 @@
-#include <algorithm> // std::sort
-#include <chrono>    // std::chrono::steady_clock, std::chrono::duration
-#include <fstream>   // std::ifstream, std::ofstream
-#include <iostream>  // std::cout
-#include <iterator>  // std::random_access_iterator (concept)
-#include <sstream>   // std::istringstream
-#include <string>    // std::string, std::getline
-#include <tuple>     // std::tie
-#include <vector>    // std::vector
-
-#include <cstdlib> // std::system
+#include <algorithm>     // std::sort
+#include <bit>           // std::bit_width
+#include <chrono>        // std::chrono::steady_clock, std::chrono::duration
+#include <cmath>         // std::log, std::exp, std::pow
+#include <deque>         // std::deque
+#include <execution>     // std::execution::par
+#include <filesystem>    // std::filesystem::file_size
+#include <fstream>       // std::ifstream
+#include <iostream>      // std::cout
+#include <numeric>       // std::accumulate
+#include <optional>      // std::optional
+#include <random>        // std::mt19937_64
+#include <sstream>       // std::ostringstream
+#include <string>        // std::string
+#include <string_view>   // std::string_view
+#include <thread>        // std::thread::hardware_concurrency
+#include <tuple>         // std::tie
+#include <unordered_map> // std::unordered_map
+#include <unordered_set> // std::unordered_set
+#include <vector>        // std::vector
+
+#include <cstdint> // std::uint32_t, std::uint64_t
+#include <cstdio>  // std::remove
+#include <cstdlib> // std::system, std::malloc, std::free
+#include <new>     // std::bad_alloc
+
+#include <malloc.h> // malloc_usable_size
 
 #include <matplot/matplot.h> // matplot::plot, ...
 
+#include "arrow_ipc.h"     // write_arrow, read_arrow
+#include "bandwidth.h"     // stream_bandwidth, MemoryTraffic, roofline
+#include "bitmap.h"        // read_indexed_columns, build_bitmaps
+#include "budget_sort.h"   // budget_sort, plan_name
+#include "cancel.h"        // CancelToken
+#include "columns.h"       // read_columns, build_orderings
+#include "datasets.h"      // load_datasets
+#include "dedup.h"         // dedup_sort, dedup_hash
+#include "direct_io.h"     // IoMode, read_csv, write_csv, drop_page_cache
+#include "energy.h"        // EnergyMeter
+#include "join.h"          // hash_join, merge_join
+#include "metrics.h"       // MetricsDumper, lab_metrics, heap_usage
+#include "name_index.h"    // NameIndex
+#include "parallel_sort.h" // parallel_merge_sort
+#include "range_index.h"   // SalaryIndex
+#include "runs.h"          // make_runs
+#include "samplesort.h"    // samplesort, parallel_samplesort
+#include "scheduler.h"     // Scheduler, TaskGroup, parallel_reduce
+#include "select.h"        // group_quantiles
+#include "setops.h"        // set_operation, diff
+#include "sketch.h"        // summarize_csv
+#include "soldier.h"       // Soldier, read_csv, write_csv
+#include "sort_engine.h"   // sort_by
+#include "sorts.h"         // insertion_sort, shaker_sort, merge_sort
+#include "table.h"         // Table, read_table, write_table
+#include "trace.h"         // LAB1_PROBE3
+
 /**
- * @brief Строка из датасета
+ * @brief Глобальный operator new, считающий выделения памяти
  *
- * Представляет собой структуру, содержащую информацию
- * о военнослужащем (ФИО, должность, подразделение, зарплата)
+ * Каждое выделение - два неупорядоченных сложения в шардах
+ * allocations/allocated_bytes текущего потока; фактический размер блока
+ * (malloc_usable_size) учитывается в heap_usage для замера пика памяти,
+ * только если режим включил этот учёт (см. HeapUsage).
  */
-struct Soldier {
-  std::string full_name; ///< ФИО
-  std::string job;       ///< Должность
-  std::string unit;      ///< Подразделение
-  int salary;            ///< Зарплата
+void *operator new(std::size_t size) {
+  allocations.add();
+  allocated_bytes.add(size);
+  if (void *p = std::malloc(size ? size : 1)) {
+    if (heap_usage.enabled())
+      heap_usage.add(malloc_usable_size(p));
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
 
-  Soldier() = default;
-  Soldier(std::string f, std::string j, std::string u, int s)
-      : full_name(f), job(j), unit(u), salary(s) {}
-};
+// GCC не видит, что operator new выше тоже подменён, и ошибочно
+// предупреждает о free() для памяти из new
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept {
+  if (p && heap_usage.enabled())
+    heap_usage.sub(malloc_usable_size(p));
+  std::free(p);
+}
+#pragma GCC diagnostic pop
+
+void operator delete[](void *p) noexcept { ::operator delete(p); }
+
+void operator delete(void *p, std::size_t) noexcept { ::operator delete(p); }
+
+void operator delete[](void *p, std::size_t) noexcept {
+  ::operator delete(p);
+}
 
 /**
- * @brief Перегрузка оператора "<" для сравнения объектов Soldier
+ * @brief Перегрузка оператора<< для вывода контейнера
+ */
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const std::vector<T> &vec) {
+  int width{50};
+  for (const auto &v : vec) {
+    std::cout << v << ' ';
+  }
+  std::cout << '\n';
+  return os;
+}
+
+/**
+ * @brief Показатель степени роста времени сортировки algo от размера
  *
- * Сначала сравниваются подразделения, затем ФИО, затем зарплата.
+ * 2 для квадратичных insertion_sort и shaker_sort, 1 для остальных
+ * (n log n на размерах датасетов растёт почти линейно).
  */
-bool operator<(const Soldier &a, const Soldier &b) {
-  return std::tie(a.unit, a.full_name, a.salary) <
-         std::tie(b.unit, b.full_name, b.salary);
+double sort_exponent(const std::string &algo) {
+  return algo == "insertion_sort" || algo == "shaker_sort" ? 2 : 1;
 }
 
 /**
- * @brief Перегрузка оператора "<" для сравнения объектов @see Soldier
+ * @brief Оценить время сортировки по степенной зависимости от размера
  *
- * Сначала сравниваются подразделения, затем ФИО, затем зарплата.
+ * По завершённым запускам методом наименьших квадратов в логарифмах
+ * подбирается time = a * size^b. По одной точке или по точкам с
+ * одинаковым размером b не определяется, и тогда берётся exponent
+ * (см. sort_exponent()), а подбирается только a.
+ *
+ * @param x размеры датасетов завершённых запусков
+ * @param y время этих запусков
+ * @param size размер, для которого нужна оценка
+ * @param exponent показатель степени на случай, когда b не определяется
+ */
+double extrapolate_time(const std::vector<double> &x,
+                        const std::vector<double> &y, double size,
+                        double exponent) {
+  if (x.empty())
+    return 0;
+  double sx{0}, sy{0}, sxx{0}, sxy{0};
+  for (std::size_t k{0}; k < x.size(); ++k) {
+    const double lx = std::log(x[k]), ly = std::log(std::max(y[k], 1e-9));
+    sx += lx;
+    sy += ly;
+    sxx += lx * lx;
+    sxy += lx * ly;
+  }
+  const double n = x.size();
+  // Знаменатель - n^2 * дисперсия логарифмов размеров
+  const double spread = n * sxx - sx * sx;
+  const double b =
+      spread > 1e-9 * n * n ? (n * sxy - sx * sy) / spread : exponent;
+  const double a = std::exp((sy - b * sx) / n);
+  return a * std::pow(size, b);
+}
+
+/**
+ * @brief Замерить время выполнения функции
+ * @param f замеряемая функция без аргументов
+ * @param repeats сколько раз её выполнить
+ * @return Среднее время одного выполнения в секундах
  */
-bool operator>(const Soldier &a, const Soldier &b) {
-  return std::tie(a.unit, a.full_name, a.salary) >
-         std::tie(b.unit, b.full_name, b.salary);
+template <class F> double time_of(F &&f, int repeats = 1) {
+  const auto start{std::chrono::steady_clock::now()};
+  for (int r{0}; r < repeats; ++r) {
+    f();
+  }
+  const auto finish{std::chrono::steady_clock::now()};
+  const std::chrono::duration<double> elapsed_seconds{finish - start};
+  return elapsed_seconds.count() / repeats;
 }
 
 /**
- * @brief Перегрузка оператора ">" для сравнения объектов @see Soldier
+ * @brief Функция для замера времени работы сортировок
+ *
+ * Если доступны счётчики RAPL (см. EnergyMeter), для каждого запуска
+ * также выводятся энергия в джоулях, джоули на миллион строк и
+ * произведение энергии на время (EDP, Дж*с).
+ *
+ * Если задан budget, сортировка получает CancelToken с этим сроком.
+ * Прерванный запуск и все следующие (датасеты идут по возрастанию
+ * размера) не выполняются до конца: их время оценивается через
+ * extrapolate_time() по завершённым запускам и помечается
+ * "extrapolated", результат сортировки для них не записывается.
  *
- * Сначала сравниваются подразделения, затем ФИО, затем зарплата.
+ * Датасеты загружаются заранее (см. load_datasets()); каждый запуск
+ * сортирует копию, снятую до начала замера.
+ *
+ * @param datasets загруженные датасеты dataset_1, dataset_2, ...
+ * @param algo какой алгоритм использовать
+ * @param io способ записи датасетов
+ * @param budget ограничение времени одного запуска в секундах (0 - нет)
+ * @return пара векторов значений (x,y), x - размеры датасетов, y -
+ * соотвествущее время сортивки (в сек.) для выборанного алгоритма
  */
-bool operator<=(const Soldier &a, const Soldier &b) {
-  return std::tie(a.unit, a.full_name, a.salary) <=
-         std::tie(b.unit, b.full_name, b.salary);
+std::pair<std::vector<double>, std::vector<double>>
+get_time(const std::vector<std::vector<Soldier>> &datasets, std::string algo,
+         IoMode io = IoMode::buffered, double budget = 0) {
+  static const EnergyMeter meter;
+  const double exponent = sort_exponent(algo);
+  std::vector<double> x, y;
+  std::vector<double> done_x, done_y;
+  bool over_budget = false;
+  for (std::size_t i{1}; i <= datasets.size(); ++i) {
+    auto data = datasets[i - 1];
+    x.push_back(data.size());
+    if (over_budget) {
+      y.push_back(extrapolate_time(done_x, done_y, x.back(), exponent));
+      std::cout << algo + ": dataset_n=" << i << " size=" << data.size()
+                << " time=" << y.back() << " extrapolated\n";
+      continue;
+    }
+
+    std::optional<CancelToken> token;
+    if (budget > 0) {
+      token.emplace(std::chrono::duration_cast<CancelToken::clock::duration>(
+          std::chrono::duration<double>(budget)));
+    }
+    const CancelToken *t = token ? &*token : nullptr;
+
+    const auto energy_start = meter.sample();
+    LAB1_PROBE3(sort_start, i, data.size(), algo.c_str());
+    const auto start{std::chrono::steady_clock::now()};
+
+    if (algo == "insertion_sort")
+      insertion_sort(data.begin(), data.end(), std::less<Soldier>(), t);
+    else if (algo == "shaker_sort")
+      shaker_sort(data.begin(), data.end(), std::less<Soldier>(), t);
+    else if (algo == "merge_sort")
+      merge_sort(data.begin(), data.end(), std::less<Soldier>(), t);
+    else if (algo == "std::sort")
+      std::sort(data.begin(), data.end(), std::less<Soldier>());
+
+    const auto finish{std::chrono::steady_clock::now()};
+    LAB1_PROBE3(sort_end, i, data.size(), algo.c_str());
+    const auto energy_finish = meter.sample();
+    const std::chrono::duration<double> elapsed_seconds{finish - start};
+
+    if (token && token->stopped()) {
+      // Прерванный запуск шёл не меньше, чем успел отработать
+      over_budget = true;
+      y.push_back(std::max(extrapolate_time(done_x, done_y, x.back(), exponent),
+                           elapsed_seconds.count()));
+      std::cout << algo + ": dataset_n=" << i << " size=" << data.size()
+                << " time=" << y.back() << " extrapolated (aborted after "
+                << elapsed_seconds.count() << ")\n";
+      continue;
+    }
+    y.push_back(elapsed_seconds.count());
+    lab_metrics().sort_seconds(algo).observe(y.back());
+    done_x.push_back(x.back());
+    done_y.push_back(y.back());
+
+    write_csv("data/out/insertion/dataset_" + std::to_string(i) + ".csv", data,
+              io);
+
+    // std::cout << "insertion_sort: iter=" << i << " done\n";
+
+    std::cout << algo + ": dataset_n=" << i << " size=" << data.size()
+              << " time=" << y.back();
+    if (meter.available()) {
+      const double joules = meter.joules(energy_start, energy_finish);
+      std::cout << " energy=" << joules << " j_per_mrow="
+                << joules * 1e6 / std::max<double>(1, x.back())
+                << " edp=" << joules * y.back();
+    }
+    std::cout << "\n";
+  }
+
+  return {x, y};
 }
 
 /**
- * @brief Перегрузка оператора ">=" для сравнения объектов @see Soldier
+ * @brief Построить несколько упорядочений датасета за одно чтение
+ *
+ * Использование: orderings <вход.csv> <каталог> <ключ>...,
+ * где ключ - список полей через запятую (например, unit,full_name,salary).
+ * Датасет читается один раз, перестановки строятся параллельно, результат
+ * для каждого ключа пишется в <каталог>/by_<поля через _>.csv
  *
- * Сначала сравниваются подразделения, затем ФИО, затем зарплата.
+ * @return код возврата программы
  */
-bool operator>=(const Soldier &a, const Soldier &b) {
-  return std::tie(a.unit, a.full_name, a.salary) >=
-         std::tie(b.unit, b.full_name, b.salary);
+int run_orderings(int argc, char *argv[]) {
+  if (argc < 5) {
+    std::cerr << "usage: " << argv[0]
+              << " orderings <input.csv> <out_dir> <key>...\n";
+    return 1;
+  }
+
+  std::vector<OrderingKey> keys;
+  std::vector<std::string> names;
+  for (int i{4}; i < argc; ++i) {
+    auto key = parse_ordering(argv[i]);
+    if (!key) {
+      std::cerr << "orderings: bad key " << argv[i] << '\n';
+      return 1;
+    }
+    keys.push_back(*key);
+    std::string name{argv[i]};
+    std::replace(name.begin(), name.end(), ',', '_');
+    names.push_back(name);
+  }
+
+  const auto start{std::chrono::steady_clock::now()};
+  const auto cols = read_columns(argv[2]);
+  const auto loaded{std::chrono::steady_clock::now()};
+  const auto perms = build_orderings(cols, keys);
+  const auto sorted{std::chrono::steady_clock::now()};
+
+  for (std::size_t i{0}; i < keys.size(); ++i) {
+    write_csv(std::string(argv[3]) + "/by_" + names[i] + ".csv", cols,
+              perms[i]);
+  }
+
+  const std::chrono::duration<double> load_seconds{loaded - start};
+  const std::chrono::duration<double> sort_seconds{sorted - loaded};
+  std::cout << "orderings: size=" << cols.size() << " keys=" << keys.size()
+            << " load=" << load_seconds.count()
+            << " sort=" << sort_seconds.count() << "\n";
+  return 0;
 }
 
 /**
- * @brief Разделить строку по разделителю
+ * @brief Сравнить соединение хешированием и слиянием на всех датасетах
  *
- * Функция позволяет разделить переданную строку (std::string)
- * по разделителю (по умолчанию - пробел). Используется для
- * считывания датасетов (.csv файл)
+ * Использование: join [справочник.csv]. Для каждого датасета замеряется
+ * время hash_join и merge_join на исходном (неупорядоченном) входе и на
+ * входе, заранее упорядоченном по подразделению, и способ, который для
+ * них выбирает plan_join(). Результат join() записывается в
+ * data/out/join/
  *
- * @param str строка, которую нужно разделить
- * @param del разделитель
- * @return Разделенную строку, представленную в виде вектора строк
+ * @return код возврата программы
  */
-std::vector<std::string> split(const std::string &str, char del = ' ') {
-  std::vector<std::string> out;
-  std::istringstream is(str);
-  std::string t;
-  while (std::getline(is, t, del)) {
-    out.push_back(t);
+int run_join(int argc, char *argv[]) {
+  const std::string units_file = argc > 2 ? argv[2] : "ref/units.csv";
+  const auto units = read_units_csv(units_file);
+  std::system("mkdir -p data/out/join/");
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto name = "dataset_" + std::to_string(i) + ".csv";
+    const auto cols = read_columns("data/in/" + name);
+
+    std::vector<Soldier> data;
+    for (auto r : build_permutation(cols, {Field::unit})) {
+      data.push_back(cols.row(r));
+    }
+    const auto sorted_cols = to_columns(data);
+
+    const double hash_t = time_of([&] { hash_join(cols, units); });
+    const double merge_t = time_of([&] { merge_join(cols, units); });
+    const double hash_sorted_t =
+        time_of([&] { hash_join(sorted_cols, units); });
+    const double merge_sorted_t =
+        time_of([&] { merge_join(sorted_cols, units); });
+
+    write_csv("data/out/join/" + name, cols, units, join(cols, units));
+
+    std::cout << "join: dataset_n=" << i << " size=" << cols.size()
+              << " hash=" << hash_t << " merge=" << merge_t
+              << " hash_sorted=" << hash_sorted_t
+              << " merge_sorted=" << merge_sorted_t
+              << " plan=" << join_plan_name(plan_join(cols, units))
+              << " plan_sorted="
+              << join_plan_name(plan_join(sorted_cols, units)) << "\n";
   }
-  return out;
+  return 0;
 }
 
 /**
- * @brief Считать датасет военнослужащих
- * @param filename Имя датасета (например, "dataset_1.csv")
- * @return Вектор объектов
+ * @brief Операции над двумя датасетами
+ *
+ * Использование: setop <union|intersection|difference|diff> <a.csv> <b.csv>
+ * <выход.csv>. Неупорядоченные входы предварительно сортируются внешне
+ * (отрезки и слияние, см. sorted_input()) во временные файлы рядом с
+ * выходным, которые удаляются по окончании; сама операция выполняется
+ * одним проходом слиянием.
+ *
+ * @return код возврата программы
  */
-std::vector<Soldier> read_csv(const std::string &filename) {
-  std::vector<Soldier> data;
-  data.reserve(150000);
-  std::ifstream ifile;
-  std::string line;
+int run_setop(int argc, char *argv[]) {
+  if (argc != 6) {
+    std::cerr << "usage: " << argv[0]
+              << " setop <union|intersection|difference|diff> <a.csv> "
+                 "<b.csv> <out.csv>\n";
+    return 1;
+  }
 
-  ifile.open(filename);
-  if (!ifile.is_open()) {
-    std::cerr << "read_csv: Couldn't open file\n";
+  const std::string op{argv[2]}, out_file{argv[5]};
+  if (op != "union" && op != "intersection" && op != "difference" &&
+      op != "diff") {
+    std::cerr << "setop: unknown operation " << op << '\n';
+    return 1;
   }
 
-  while (std::getline(ifile, line)) {
-    std::vector<std::string> fields_v = split(line, ',');
-    Soldier obj(fields_v[0], fields_v[1], fields_v[2], std::stoi(fields_v[3]));
-    data.emplace_back(obj);
+  const std::string a_tmp = out_file + ".a.tmp", b_tmp = out_file + ".b.tmp";
+  const auto a = sorted_input(argv[3], a_tmp);
+  const auto b = sorted_input(argv[4], b_tmp);
+
+  if (op == "diff") {
+    const auto stats = diff(a, b, out_file);
+    std::cout << "diff: added=" << stats.added << " removed=" << stats.removed
+              << " changed=" << stats.changed << "\n";
+  } else {
+    const auto set_op = op == "union"          ? SetOp::union_
+                        : op == "intersection" ? SetOp::intersection
+                                               : SetOp::difference;
+    std::cout << op << ": rows=" << set_operation(set_op, a, b, out_file)
+              << "\n";
   }
 
-  return data;
+  std::remove(a_tmp.c_str());
+  std::remove(b_tmp.c_str());
+  return 0;
 }
 
 /**
- * @brief Записать вектор данных в .csv файл
- * @param filename имя файла
- * @param data вектор объектов
+ * @brief Сравнить удаление повторов сортировкой и хешированием
+ *
+ * Использование: dedup. К каждому датасету дописывается копия его первой
+ * половины (как при повторной выгрузке), после чего замеряется время
+ * dedup_sort и dedup_hash для полного совпадения и совпадения по ключу.
+ * Результат dedup() записывается в data/out/dedup/
+ *
+ * @return код возврата программы
  */
-void write_csv(std::string filename, const std::vector<Soldier> &data) {
-  std::ofstream ofile(filename);
-  if (!ofile.is_open()) {
-    std::cerr << "read_csv: Couldn't open file\n";
+int run_dedup() {
+  std::system("mkdir -p data/out/dedup/");
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto name = "dataset_" + std::to_string(i) + ".csv";
+    auto input = read_csv("data/in/" + name);
+    const std::vector<Soldier> repeated(input.begin(),
+                                        input.begin() + input.size() / 2);
+    input.insert(input.end(), repeated.begin(), repeated.end());
+
+    std::cout << "dedup: dataset_n=" << i << " size=" << input.size();
+    for (auto mode : {DedupKey::exact, DedupKey::key}) {
+      for (auto strategy : {DedupStrategy::sort, DedupStrategy::hash}) {
+        auto data = input;
+        const auto start{std::chrono::steady_clock::now()};
+        if (strategy == DedupStrategy::sort)
+          dedup_sort(data, mode);
+        else
+          dedup_hash(data, mode);
+        const auto finish{std::chrono::steady_clock::now()};
+        const std::chrono::duration<double> elapsed_seconds{finish - start};
+        std::cout << (mode == DedupKey::exact ? " exact_" : " key_")
+                  << (strategy == DedupStrategy::sort ? "sort=" : "hash=")
+                  << elapsed_seconds.count() << " (" << data.size() << ")";
+      }
+    }
+    std::cout << " planned="
+              << (choose_dedup(input.size(), false) == DedupStrategy::sort
+                      ? "sort"
+                      : "hash")
+              << "\n";
+
+    dedup(input, DedupKey::exact);
+    write_csv("data/out/dedup/" + name, input);
   }
-  for (const auto &v : data) {
-    ofile << v.full_name << ',' << v.job << ',' << v.unit << ',' << v.salary
-          << '\n';
+  return 0;
+}
+
+/**
+ * @brief Сравнить индекс по зарплате с линейным просмотром
+ *
+ * Использование: range [lo hi] (по умолчанию 20000 25000). Для каждого
+ * датасета строится SalaryIndex и замеряется среднее время запросов
+ * count и find против просмотра вектора объектов.
+ *
+ * @return код возврата программы
+ */
+int run_range(int argc, char *argv[]) {
+  // volatile, чтобы компилятор не выбросил запросы из цикла замера
+  volatile int lo = argc > 3 ? std::stoi(argv[2]) : 20000;
+  volatile int hi = argc > 3 ? std::stoi(argv[3]) : 25000;
+  constexpr int repeats{1000};
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto data =
+        read_csv("./data/in/dataset_" + std::to_string(i) + ".csv");
+    std::vector<int> salary;
+    for (const auto &s : data) {
+      salary.push_back(s.salary);
+    }
+    const SalaryIndex index(salary);
+
+    volatile std::size_t found{0}, scanned{0};
+    const double count_t =
+        time_of([&] { found = index.count(lo, hi); }, repeats);
+    const double find_t =
+        time_of([&] { found = index.find(lo, hi).size(); }, repeats);
+    const double scan_t = time_of(
+        [&] {
+          std::vector<std::uint32_t> rows;
+          for (std::uint32_t r{0}; r < data.size(); ++r) {
+            if (data[r].salary >= lo && data[r].salary <= hi)
+              rows.push_back(r);
+          }
+          scanned = rows.size();
+        },
+        repeats);
+
+    std::cout << "range: dataset_n=" << i << " size=" << data.size()
+              << " rows=" << found << " (scan " << scanned << ")"
+              << " index_bytes=" << index.bytes()
+              << " column_bytes=" << salary.size() * sizeof(int)
+              << " count=" << count_t << " find=" << find_t
+              << " scan=" << scan_t << "\n";
   }
+  return 0;
 }
 
 /**
- * @brief Перегрузка оператора<< для вывода контейнера
+ * @brief Сравнить битовые индексы с линейным просмотром
+ *
+ * Использование: bitmap. Каждый датасет загружается в столбцы с
+ * индексами по подразделению и должности, построенными при загрузке
+ * (read_indexed_columns(); время сравнивается с read_columns() без
+ * индексов и с отдельным build_bitmaps()), и замеряется время двух
+ * фильтров: "подразделение A и должность B или C" и "не подразделение
+ * A и должность B" - через операции над наборами и просмотром строк.
+ *
+ * @return код возврата программы
  */
-template <typename T>
-std::ostream &operator<<(std::ostream &os, const std::vector<T> &vec) {
-  int width{50};
-  for (const auto &v : vec) {
-    std::cout << v << ' ';
+int run_bitmap() {
+  constexpr int repeats{100};
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto name = "./data/in/dataset_" + std::to_string(i) + ".csv";
+    const auto data = read_csv(name);
+    SoldierColumns plain;
+    const double load_t = time_of([&] { plain = read_columns(name); });
+    const double build_t = time_of([&] { build_bitmaps(plain); });
+    IndexedColumns indexed;
+    const double indexed_load_t =
+        time_of([&] { indexed = read_indexed_columns(name); });
+    const auto &cols = indexed.cols;
+    const auto &index = indexed.bitmaps;
+
+    const auto &unit_a = cols.units.values[0];
+    const auto &job_b = cols.jobs.values[0];
+    const auto &job_c = cols.jobs.values[1 % cols.jobs.values.size()];
+    const auto &a = index.unit[cols.units.index.at(unit_a)];
+    const auto &b = index.job[cols.jobs.index.at(job_b)];
+    const auto &c = index.job[cols.jobs.index.at(job_c)];
+
+    volatile std::size_t q1{0}, q2{0}, s1{0}, s2{0};
+    const double bitmap_t = time_of(
+        [&] {
+          q1 = (a & (b | c)).cardinality();
+          q2 = (a.flip(index.rows) & b).cardinality();
+        },
+        repeats);
+    const double scan_t = time_of(
+        [&] {
+          std::size_t n1{0}, n2{0};
+          for (const auto &s : data) {
+            n1 += s.unit == unit_a && (s.job == job_b || s.job == job_c);
+            n2 += s.unit != unit_a && s.job == job_b;
+          }
+          s1 = n1;
+          s2 = n2;
+        },
+        repeats);
+
+    std::cout << "bitmap: dataset_n=" << i << " size=" << data.size()
+              << " q1=" << q1 << " (scan " << s1 << ") q2=" << q2
+              << " (scan " << s2 << ") index_bytes=" << index.bytes()
+              << " load=" << load_t << " build=" << build_t
+              << " indexed_load=" << indexed_load_t << " bitmap=" << bitmap_t
+              << " scan=" << scan_t << "\n";
   }
-  std::cout << '\n';
-  return os;
+  return 0;
+}
+
+/**
+ * @brief Сравнить выбор квантилей по подразделениям с полной сортировкой
+ *
+ * Использование: select. Для каждого датасета вычисляются 10, 25, 50, 75
+ * и 90 процентили зарплаты по подразделениям через group_quantiles() и
+ * через merge_sort() по (подразделение, зарплата); для последнего
+ * датасета выводятся медианы.
+ *
+ * @return код возврата программы
+ */
+int run_select() {
+  const std::vector<double> qs{0.1, 0.25, 0.5, 0.75, 0.9};
+  std::vector<std::vector<int>> result;
+  SoldierColumns cols;
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto name = "./data/in/dataset_" + std::to_string(i) + ".csv";
+    cols = read_columns(name);
+    auto data = read_csv(name);
+
+    auto start{std::chrono::steady_clock::now()};
+    result = group_quantiles(cols.unit, cols.salary, cols.units.values.size(),
+                             qs);
+    auto finish{std::chrono::steady_clock::now()};
+    const std::chrono::duration<double> select_seconds{finish - start};
+
+    start = std::chrono::steady_clock::now();
+    merge_sort(data.begin(), data.end(), [](const auto &a, const auto &b) {
+      return std::tie(a.unit, a.salary) < std::tie(b.unit, b.salary);
+    });
+    finish = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> sort_seconds{finish - start};
+
+    std::cout << "select: dataset_n=" << i << " size=" << data.size()
+              << " select=" << select_seconds.count()
+              << " merge_sort=" << sort_seconds.count() << "\n";
+  }
+
+  for (std::size_t u{0}; u < result.size(); ++u) {
+    std::cout << cols.units.values[u] << ": median=" << result[u][2] << "\n";
+  }
+  return 0;
 }
 
 /**
- * @brief Сортировка вставкой
- * @param first итератор на начало контейнера
- * @param last итератор на конец контейнера
- * @param comp фукнция сравнения
+ * @brief Сравнить приближённую сводку со точными значениями
+ *
+ * Использование: sketch [число потоков]. Для каждого датасета строится
+ * SoldierSummary за один проход по файлу и сравнивается с точными
+ * медианой зарплаты по подразделениям и числом различных ФИО.
+ *
+ * @return код возврата программы
  */
-template <std::random_access_iterator RandomAccessIterator, class Compare>
-void insertion_sort(RandomAccessIterator first, RandomAccessIterator last,
-                    Compare comp) {
-  for (auto i = first + 1; i < last; ++i) {
-    auto t = *i;
-    for (auto j = i - 1; j >= first; --j) {
-      if (comp(t, *j)) {
-        std::iter_swap(j, j + 1);
-      }
+int run_sketch(int argc, char *argv[]) {
+  const unsigned threads =
+      argc > 2 ? std::stoul(argv[2])
+               : std::max(2u, std::thread::hardware_concurrency());
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto name = "./data/in/dataset_" + std::to_string(i) + ".csv";
+
+    const auto start{std::chrono::steady_clock::now()};
+    const auto summary = summarize_csv(name, threads);
+    const auto finish{std::chrono::steady_clock::now()};
+    const std::chrono::duration<double> elapsed_seconds{finish - start};
+
+    const auto cols = read_columns(name);
+    const auto exact = group_quantiles(cols.unit, cols.salary,
+                                       cols.units.values.size(), {0.5});
+    const std::unordered_set<std::string> names(cols.full_name.begin(),
+                                                cols.full_name.end());
+
+    std::cout << "sketch: dataset_n=" << i << " size=" << summary.rows
+              << " time=" << elapsed_seconds.count()
+              << " names=" << summary.names.estimate() << " (exact "
+              << names.size() << ")";
+    for (std::size_t u{0}; u < cols.units.values.size(); ++u) {
+      const auto &sketch = summary.salary_by_unit.at(cols.units.values[u]);
+      std::cout << " median_" << u << "=" << sketch.quantile(0.5) << " ("
+                << exact[u][0] << ")";
     }
+    std::cout << "\n";
+  }
+  return 0;
+}
+
+/**
+ * @brief Сравнить хеш-индекс по ФИО с std::unordered_map
+ *
+ * Использование: names [число потоков]. Для каждого датасета замеряется
+ * построение NameIndex и std::unordered_map<std::string_view, ...>, а
+ * также поиск всех ФИО датасета по одному и пакетом.
+ *
+ * @return код возврата программы
+ */
+int run_names(int argc, char *argv[]) {
+  const unsigned threads =
+      argc > 2 ? std::stoul(argv[2])
+               : std::max(1u, std::thread::hardware_concurrency());
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto cols =
+        read_columns("./data/in/dataset_" + std::to_string(i) + ".csv");
+    const std::vector<std::string_view> keys(cols.full_name.begin(),
+                                             cols.full_name.end());
+
+    std::optional<NameIndex> index;
+    std::unordered_map<std::string_view, std::uint32_t> map;
+    const double index_build =
+        time_of([&] { index.emplace(cols.full_name, threads); });
+    const double map_build = time_of([&] {
+      for (std::uint32_t r{0}; r < keys.size(); ++r)
+        map.try_emplace(keys[r], r);
+    });
+
+    volatile std::uint32_t sink{0};
+    std::vector<std::uint32_t> rows;
+    const double index_find = time_of([&] {
+      for (auto k : keys)
+        sink = index->find(k);
+    });
+    const double index_batch = time_of([&] { index->find_batch(keys, rows); });
+    const double map_find = time_of([&] {
+      for (auto k : keys)
+        sink = map.find(k)->second;
+    });
+
+    std::cout << "names: dataset_n=" << i << " size=" << keys.size()
+              << " index_build=" << index_build << " map_build=" << map_build
+              << " index_find=" << index_find
+              << " index_batch=" << index_batch << " map_find=" << map_find
+              << "\n";
   }
+  return 0;
 }
-// 4,5,1,3,2
-// 1,4,5,3,2
-// 1,3,4,5,2
-// 1,2,3,4,5
 
 /**
- * @brief Шейкер-сортировка
- * @param first итератор на начало контейнера
- * @param last итератор на конец контейнера
- * @param comp фукнция сравнения
+ * @brief Сравнить обычное чтение датасетов с чтением мимо кэша страниц
+ *
+ * Использование: io [cold|cached]. В режиме cold (по умолчанию) перед
+ * каждым чтением файл вытесняется из кэша страниц, в режиме cached -
+ * заранее читается, чтобы оказаться в кэше. Для каждого датасета
+ * замеряются read_csv и write_csv в режимах IoMode::buffered и
+ * IoMode::direct.
+ *
+ * @return код возврата программы
  */
-template <std::random_access_iterator RandomAccessIterator, class Compare>
-void shaker_sort(RandomAccessIterator first, RandomAccessIterator last,
-                 Compare comp) {
-  auto left_bound = first;
-  auto right_bound = last - 1;
-  bool no_swaps = true;
-
-  while (left_bound <= right_bound) {
-    for (auto i = left_bound; i < right_bound; ++i) {
-      if (comp(*(i + 1), *i)) {
-        std::iter_swap(i + 1, i);
-        no_swaps = false;
+int run_io(int argc, char *argv[]) {
+  const bool cold = !(argc > 2 && std::string(argv[2]) == "cached");
+  std::system("mkdir -p data/out/io/");
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto name = "dataset_" + std::to_string(i) + ".csv";
+    const auto in = "./data/in/" + name, out = "data/out/io/" + name;
+
+    std::cout << "io: dataset_n=" << i << (cold ? " cold" : " cached");
+    std::vector<Soldier> data;
+    for (auto mode : {IoMode::buffered, IoMode::direct}) {
+      if (cold)
+        drop_page_cache(in);
+      else
+        read_csv(in);
+      const double read_t = time_of([&] { data = read_csv(in, mode); });
+      bool written{false};
+      const double write_t =
+          time_of([&] { written = write_csv(out, data, mode); });
+      std::cout << (mode == IoMode::buffered ? " buffered" : " direct")
+                << "_read=" << read_t << " write=" << write_t
+                << (written ? "" : " WRITE_FAILED");
+    }
+    std::cout << " size=" << data.size() << "\n";
+  }
+  return 0;
+}
+
+/**
+ * @brief Разбить датасет на отсортированные отрезки
+ *
+ * Использование: runs <вход.csv> <память в байтах> [префикс]. Отрезки
+ * строятся выбором с замещением (make_runs) и пишутся в файлы
+ * <префикс><номер>.run (по умолчанию data/out/runs/run_).
+ *
+ * @return код возврата программы
+ */
+int run_runs(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cerr << "usage: " << argv[0]
+              << " runs <input.csv> <memory_bytes> [prefix]\n";
+    return 1;
+  }
+  const std::string prefix = argc > 4 ? argv[4] : "data/out/runs/run_";
+  if (argc <= 4) {
+    std::system("mkdir -p data/out/runs/");
+  }
+
+  const auto start{std::chrono::steady_clock::now()};
+  const auto stats = make_runs(argv[2], prefix, std::stoull(argv[3]));
+  const auto finish{std::chrono::steady_clock::now()};
+  const std::chrono::duration<double> elapsed_seconds{finish - start};
+
+  std::size_t rows{0};
+  for (auto len : stats.lengths) {
+    rows += len;
+  }
+  std::cout << "runs: size=" << rows << " heap_rows=" << stats.heap_rows
+            << " runs=" << stats.files.size() << " avg_run="
+            << (stats.files.empty() ? 0.0
+                                    : double(rows) / stats.files.size())
+            << " time=" << elapsed_seconds.count() << "\n";
+  return 0;
+}
+
+/**
+ * @brief Сравнить сортировки на тривиально копируемых ключах
+ *
+ * Использование: pod. Столбец зарплат сортируется каждой сортировкой
+ * дважды: в std::vector<int> (непрерывная память - ветка по сырым
+ * указателям) и в std::deque<int> (общая ветка через итераторы).
+ * Квадратичные сортировки запускаются на первых 6 датасетах.
+ *
+ * @return код возврата программы
+ */
+int run_pod() {
+  for (int i{1}; i <= 15; ++i) {
+    const auto data =
+        read_csv("./data/in/dataset_" + std::to_string(i) + ".csv");
+    std::vector<int> salary;
+    for (const auto &s : data) {
+      salary.push_back(s.salary);
+    }
+
+    std::cout << "pod: dataset_n=" << i << " size=" << salary.size();
+    for (std::string algo : {"insertion_sort", "shaker_sort", "merge_sort"}) {
+      if (algo != "merge_sort" && i > 6)
+        continue;
+      auto sort_with = [&](auto &keys) {
+        const auto start{std::chrono::steady_clock::now()};
+        if (algo == "insertion_sort")
+          insertion_sort(keys.begin(), keys.end(), std::less<int>());
+        else if (algo == "shaker_sort")
+          shaker_sort(keys.begin(), keys.end(), std::less<int>());
+        else
+          merge_sort(keys.begin(), keys.end(), std::less<int>());
+        const auto finish{std::chrono::steady_clock::now()};
+        const std::chrono::duration<double> elapsed_seconds{finish - start};
+        return elapsed_seconds.count();
+      };
+      std::vector<int> contiguous(salary);
+      std::deque<int> generic(salary.begin(), salary.end());
+      std::cout << ' ' << algo << "=" << sort_with(contiguous) << " ("
+                << sort_with(generic) << " generic)";
+    }
+    std::cout << "\n";
+  }
+  return 0;
+}
+
+/**
+ * @brief Сравнить sort_by() с merge_sort() для разных типов ключей
+ *
+ * Использование: dispatch. Для каждого датасета строки сортируются по
+ * зарплате (целочисленный ключ - radix_sort), по ФИО (строковый ключ -
+ * string_sort) и по (подразделение, ФИО, зарплата) (кортеж - сортировка
+ * сравнением); для сравнения - merge_sort() с тем же порядком.
+ *
+ * @return код возврата программы
+ */
+int run_dispatch() {
+  auto by_salary = [](const Soldier &s) { return s.salary; };
+  auto by_name = [](const Soldier &s) -> const std::string & {
+    return s.full_name;
+  };
+  auto by_tuple = [](const Soldier &s) {
+    return std::tie(s.unit, s.full_name, s.salary);
+  };
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto data =
+        read_csv("./data/in/dataset_" + std::to_string(i) + ".csv");
+    std::cout << "dispatch: dataset_n=" << i << " size=" << data.size();
+    auto compare = [&](const std::string &key, auto proj) {
+      auto engine = data, reference = data;
+      const double t_engine =
+          time_of([&] { sort_by(engine.begin(), engine.end(), proj); });
+      const double t_merge = time_of([&] {
+        merge_sort(reference.begin(), reference.end(),
+                   [&](const Soldier &a, const Soldier &b) {
+                     return proj(a) < proj(b);
+                   });
+      });
+      bool same = true;
+      for (std::size_t r{0}; r < data.size(); ++r) {
+        same = same && !(proj(engine[r]) < proj(reference[r])) &&
+               !(proj(reference[r]) < proj(engine[r]));
       }
+      std::cout << ' ' << key << "=" << t_engine << " (merge_sort "
+                << t_merge << (same ? "" : ", MISMATCH") << ")";
+    };
+    compare("salary", by_salary);
+    compare("full_name", by_name);
+    compare("tuple", by_tuple);
+    std::cout << "\n";
+  }
+  return 0;
+}
+
+/**
+ * @brief Оценить, ограничены ли алгоритмы памятью или вычислениями
+ *
+ * Использование: roofline [число потоков]. Сначала измеряются пиковая
+ * пропускная способность памяти (stream_bandwidth, один поток и все
+ * потоки) и пиковая скорость сравнений (compare_throughput). Затем для
+ * каждого датасета замеряются parse_csv, merge_sort и radix_sort столбца
+ * зарплат; для каждого выводятся достигнутые ГБ/с и положение на модели
+ * roofline относительно однопоточного пика.
+ *
+ * Операции: для parse_csv - разобранные символы, для merge_sort -
+ * сравнения (подсчитываются отдельным запуском), для radix_sort -
+ * обработанные разряды. Байты берутся из MemoryTraffic, если счётчик
+ * доступен (source=counter), иначе из модели (source=model): каждый
+ * уровень слияния читает и пишет массив и копирует левую половину в
+ * буфер, каждый проход radix_sort дважды читает и один раз пишет пары
+ * (ключ, номер).
+ *
+ * @return код возврата программы
+ */
+int run_roofline(int argc, char *argv[]) {
+  const unsigned threads =
+      argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+  const StreamResult single = stream_bandwidth();
+  const StreamResult all = stream_bandwidth(std::size_t{1} << 24, threads);
+  const double peak_gbps = single.peak();
+  const double peak_gops = compare_throughput();
+  std::cout << "roofline: copy=" << single.copy << " scale=" << single.scale
+            << " add=" << single.add << " triad=" << single.triad
+            << " all_threads=" << all.peak() << " peak_gbps=" << peak_gbps
+            << " peak_gops=" << peak_gops
+            << " ridge=" << peak_gops / peak_gbps << "\n";
+
+  MemoryTraffic traffic;
+  auto report = [&](const std::string &algo, int i, std::size_t n, auto f,
+                    double ops, double model_bytes) {
+    traffic.start();
+    const auto start{std::chrono::steady_clock::now()};
+    f();
+    const auto finish{std::chrono::steady_clock::now()};
+    const auto counted = traffic.stop();
+    const std::chrono::duration<double> elapsed_seconds{finish - start};
+    const double bytes = counted.value_or(model_bytes);
+    const auto p = roofline(bytes, ops, elapsed_seconds.count(), peak_gbps,
+                            peak_gops);
+    std::cout << "roofline: " << algo << " dataset_n=" << i << " size=" << n
+              << " time=" << elapsed_seconds.count() << " bytes=" << bytes
+              << " source=" << (counted ? "counter" : "model")
+              << " gbps=" << p.gbps << " gops=" << p.gops
+              << " intensity=" << p.intensity
+              << " attainable=" << p.attainable << " bound=" << p.bound
+              << "\n";
+  };
+
+  for (int i{1}; i <= 15; ++i) {
+    const std::string filename =
+        "./data/in/dataset_" + std::to_string(i) + ".csv";
+    std::ifstream ifile(filename, std::ios::binary);
+    const std::string text((std::istreambuf_iterator<char>(ifile)),
+                           std::istreambuf_iterator<char>());
+    const auto rows = std::count(text.begin(), text.end(), '\n');
+    std::vector<Soldier> data;
+    report("parse_csv", i, rows, [&] { data = parse_csv(text); },
+           text.size(), 2.0 * text.size() + rows * sizeof(Soldier));
+
+    std::vector<int> salary;
+    for (const auto &s : data) {
+      salary.push_back(s.salary);
     }
-    ++left_bound;
-    if (no_swaps)
-      break;
+    const double n = salary.size();
+    const auto key_bytes = sizeof(int);
+
+    std::size_t comparisons{0};
+    auto counted = salary;
+    merge_sort(counted.begin(), counted.end(), [&](int a, int b) {
+      ++comparisons;
+      return a < b;
+    });
+    const double levels = std::bit_width(salary.size() / 16);
+    auto merged = salary;
+    report("merge_sort", i, salary.size(),
+           [&] { merge_sort(merged.begin(), merged.end(), std::less<int>()); },
+           comparisons, n * key_bytes * (2 + 3 * levels));
 
-    for (auto i = right_bound; i >= left_bound; --i) {
-      if (comp(*i, *(i - 1))) {
-        std::iter_swap(i, i - 1);
+    int passes{0};
+    for (unsigned shift{0}; shift < 32; shift += 8) {
+      bool differ = false;
+      for (int v : salary) {
+        differ = differ || ((v ^ salary[0]) >> shift & 0xff) != 0;
       }
+      passes += differ;
     }
-    --right_bound;
-    if (no_swaps)
-      break;
+    const double pair_bytes = key_bytes + sizeof(std::uint32_t);
+    auto radixed = salary;
+    report("radix_sort", i, salary.size(),
+           [&] { radix_sort(radixed.begin(), radixed.end(), std::identity()); },
+           n * passes,
+           n * (key_bytes + pair_bytes) + n * passes * 3 * pair_bytes +
+               n * (pair_bytes + 4 * key_bytes));
   }
+  return 0;
 }
 
-// 5,4,1,3,2
-//
+/**
+ * @brief Числа Фибоначчи с порождением задачи на каждом уровне
+ *
+ * Ниже cutoff считается последовательно; при cutoff = 0 задача
+ * порождается на каждом вызове - замер накладных расходов fork/join.
+ */
+long fib(Scheduler &sched, int n, int cutoff) {
+  if (n < 2)
+    return n;
+  if (n <= cutoff)
+    return fib(sched, n - 1, cutoff) + fib(sched, n - 2, cutoff);
+  long a{0}, b{0};
+  parallel_invoke(
+      sched, [&] { a = fib(sched, n - 1, cutoff); },
+      [&] { b = fib(sched, n - 2, cutoff); });
+  return a + b;
+}
 
 /**
- * @brief  Функция для слияния двух отсортированных массивов при сортировке
- * слиянием
- * @param l_first итератор на начало 1-ого контейнера
- * @param l_last итератор на конец 1-ого контейнера
- * @param r_first итератор на начало 2-ого контейнера
- * @param r_last итератор на конец 2-ого контейнера
- * @param comp функция сравнения
+ * @brief Замерить планировщик с кражей работы
+ *
+ * Использование: sched [число потоков] [pin]. Выводятся:
+ * - стоимость порождения и выполнения пустой задачи из внешнего потока
+ *   и из рабочего (через свой дек);
+ * - fib(30) с порождением на каждом уровне и с отсечкой на 20 против
+ *   последовательного вычисления;
+ * - параллельная сумма 2^25 чисел (parallel_reduce) против
+ *   std::accumulate;
+ * - parallel_merge_sort против merge_sort для каждого датасета.
+ *
+ * @return код возврата программы
  */
-template <std::random_access_iterator RandomAccessIterator, class Compare>
-void merge(RandomAccessIterator l_first, RandomAccessIterator l_last,
-           RandomAccessIterator r_first, RandomAccessIterator r_last,
-           Compare comp) {
-  std::vector result(l_first, l_last);
-  result.clear();
-
-  auto i = l_first, j = r_first;
-  while (i < l_last and j < r_last) {
-    if (comp(*i, *j)) {
-      result.push_back(*i);
-      ++i;
-    } else {
-      result.push_back(*j);
-      ++j;
-    }
+int run_sched(int argc, char *argv[]) {
+  const unsigned threads =
+      argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+  const bool pin = argc > 3 && std::string(argv[3]) == "pin";
+  Scheduler sched(threads, pin);
+
+  constexpr int spawns{1000000};
+  const double outside = time_of([&] {
+    TaskGroup group(sched);
+    for (int k{0}; k < spawns; ++k)
+      group.run([] {});
+    group.wait();
+  });
+  const double inside = time_of([&] {
+    TaskGroup outer(sched);
+    outer.run([&] {
+      TaskGroup group(sched);
+      for (int k{0}; k < spawns; ++k)
+        group.run([] {});
+      group.wait();
+    });
+    outer.wait();
+  });
+  std::cout << "sched: threads=" << sched.size()
+            << " spawn_outside_ns=" << outside / spawns * 1e9
+            << " spawn_inside_ns=" << inside / spawns * 1e9 << "\n";
+
+  volatile long sink{0};
+  const double fib_serial = time_of([&] { sink = fib(sched, 30, 30); });
+  const double fib_every = time_of([&] { sink = fib(sched, 30, 0); });
+  const double fib_cutoff = time_of([&] { sink = fib(sched, 30, 20); });
+  std::cout << "sched: fib(30)=" << sink << " serial=" << fib_serial
+            << " every_level=" << fib_every << " cutoff_20=" << fib_cutoff
+            << "\n";
+
+  std::vector<long> values(std::size_t{1} << 25);
+  std::iota(values.begin(), values.end(), 0);
+  volatile long total{0};
+  const double sum_serial = time_of(
+      [&] { total = std::accumulate(values.begin(), values.end(), 0L); });
+  const double sum_parallel = time_of([&] {
+    total = parallel_reduce<long>(
+        sched, 0, values.size(), 1 << 16,
+        [&](std::size_t b, std::size_t e) {
+          return std::accumulate(values.begin() + b, values.begin() + e, 0L);
+        },
+        [](long a, long b) { return a + b; });
+  });
+  std::cout << "sched: sum=" << total << " serial=" << sum_serial
+            << " parallel=" << sum_parallel << "\n";
+
+  for (int i{1}; i <= 15; ++i) {
+    const auto data =
+        read_csv("./data/in/dataset_" + std::to_string(i) + ".csv");
+    auto serial = data, parallel = data;
+    const double t_serial = time_of([&] {
+      merge_sort(serial.begin(), serial.end(), std::less<Soldier>());
+    });
+    const double t_parallel = time_of([&] {
+      parallel_merge_sort(sched, parallel.begin(), parallel.end(),
+                          std::less<Soldier>());
+    });
+    std::cout << "sched: merge_sort dataset_n=" << i << " size=" << data.size()
+              << " serial=" << t_serial << " parallel=" << t_parallel
+              << (std::is_sorted(parallel.begin(), parallel.end())
+                      ? ""
+                      : " UNSORTED")
+              << "\n";
   }
+  return 0;
+}
 
-  for (; i < l_last; ++i) {
-    result.push_back(*i);
+/**
+ * @brief Сравнить столбцовый движок со схемой и SoldierColumns
+ *
+ * Использование: table [схема] [ключ]. По умолчанию схема датасетов
+ * военнослужащих (см. soldier_schema()) и ключ unit,full_name,salary.
+ * Для каждого датасета замеряются чтение и построение перестановки
+ * через Table и, если схема совпадает с Soldier, через SoldierColumns;
+ * результат пишется в data/out/table/. Несовпадение перестановок
+ * помечается MISMATCH.
+ *
+ * @return код возврата программы
+ */
+int run_table(int argc, char *argv[]) {
+  const auto schema = argc > 2 ? parse_schema(argv[2]) : soldier_schema();
+  if (!schema) {
+    std::cerr << "table: bad schema " << argv[2] << '\n';
+    return 1;
   }
+  const std::string key_spec = argc > 3 ? argv[3] : "unit,full_name,salary";
+  const bool soldier = argc <= 2;
+  std::system("mkdir -p data/out/table/");
+
+  for (int i{1}; i <= 15; ++i) {
+    const std::string name = "dataset_" + std::to_string(i) + ".csv";
+    Table table(*schema);
+    const double t_load =
+        time_of([&] { table = read_table("./data/in/" + name, *schema); });
+    const auto key = parse_table_key(table, key_spec);
+    if (!key) {
+      std::cerr << "table: bad key " << key_spec << '\n';
+      return 1;
+    }
+    std::vector<std::uint32_t> perm;
+    const double t_sort =
+        time_of([&] { perm = build_permutation(table, *key); });
+    write_table("data/out/table/" + name, table, perm);
 
-  for (; j < r_last; ++j) {
-    result.push_back(*j);
+    std::cout << "table: dataset_n=" << i << " size=" << table.rows
+              << " load=" << t_load << " sort=" << t_sort;
+    if (soldier) {
+      SoldierColumns cols;
+      const double t_cols_load =
+          time_of([&] { cols = read_columns("./data/in/" + name); });
+      const auto ordering = parse_ordering(key_spec);
+      std::vector<std::uint32_t> reference;
+      const double t_cols_sort = time_of(
+          [&] { reference = build_permutation(cols, *ordering); });
+      std::cout << " soldier_load=" << t_cols_load
+                << " soldier_sort=" << t_cols_sort
+                << (perm == reference ? "" : " MISMATCH");
+    }
+    std::cout << "\n";
   }
+  return 0;
+}
 
-  std::copy(result.begin(), result.end(), l_first);
+/**
+ * @brief Строка таблицы в виде .csv (для сравнения таблиц)
+ * @param table таблица
+ * @param r номер строки
+ */
+std::string table_row(const Table &table, std::uint32_t r) {
+  std::ostringstream os;
+  for (const auto &column : table.columns)
+    std::visit([&](const auto &col) { col.write(os << ',', r); }, column);
+  return os.str();
 }
 
 /**
- * @brief Сортировка слиянием
- * @param first итератор на начало контейнера
- * @param last итератор на конец контейнера
- * @param comp фукнция сравнения
+ * @brief Замерить экспорт и импорт Arrow IPC
+ *
+ * Использование: arrow. Каждый датасет читается в Table, сортируется
+ * по unit,full_name,salary и пишется в data/out/arrow/ файлом (.arrow)
+ * и потоком (.arrows); оба читаются обратно. Выводятся времена записи
+ * и чтения против read_table() и размер файла; если прочитанное не
+ * совпадает с записанным, строка помечается MISMATCH.
+ *
+ * @return код возврата программы
  */
-template <std::random_access_iterator RandomAccessIterator, class Compare>
-void merge_sort(RandomAccessIterator first, RandomAccessIterator last,
-                Compare comp) {
-  if (first + 1 == last) {
-    return;
-  }
+int run_arrow() {
+  std::system("mkdir -p data/out/arrow/");
 
-  long mid = std::distance(first, last) / 2;
+  for (int i{1}; i <= 15; ++i) {
+    const std::string name = "dataset_" + std::to_string(i);
+    Table table(soldier_schema());
+    const double t_csv = time_of([&] {
+      table = read_table("./data/in/" + name + ".csv", table.schema);
+    });
+    const auto key = parse_table_key(table, "unit,full_name,salary");
+    const auto perm = build_permutation(table, *key);
 
-  merge_sort(first, first + mid, comp);
-  merge_sort(first + mid, last, comp);
+    std::cout << "arrow: dataset_n=" << i << " size=" << table.rows
+              << " read_csv=" << t_csv;
+    for (auto format : {ArrowFormat::file, ArrowFormat::stream}) {
+      const bool file = format == ArrowFormat::file;
+      const std::string out =
+          "data/out/arrow/" + name + (file ? ".arrow" : ".arrows");
+      const double t_write =
+          time_of([&] { write_arrow(out, table, perm, format); });
+      std::optional<Table> back;
+      const double t_read = time_of([&] { back = read_arrow(out); });
 
-  return merge(first, first + mid, first + mid, last, comp);
+      bool same = back && back->rows == table.rows;
+      for (std::uint32_t r{0}; same && r < table.rows; ++r)
+        same = table_row(*back, r) == table_row(table, perm[r]);
+      std::cout << (file ? " file" : " stream") << "_write=" << t_write
+                << ' ' << (file ? "file" : "stream") << "_read=" << t_read
+                << ' ' << (file ? "file" : "stream")
+                << "_bytes=" << std::filesystem::file_size(out)
+                << (same ? "" : " MISMATCH");
+    }
+    std::cout << "\n";
+  }
+  return 0;
 }
 
 /**
- * @brief Функция для замера времени работы сортировок
- * @param j число датасетов для сортивроки
- * @param algo какой алгоритм использовать
- * @return пара векторов значений (x,y), x - размеры датасетов, y -
- * соотвествущее время сортивки (в сек.) для выборанного алгоритма
+ * @brief Разобрать размер памяти вида 512K, 64M, 2G (или число байт)
+ * @param spec строка размера
+ * @return Размер в байтах
  */
-std::pair<std::vector<double>, std::vector<double>> get_time(int j,
-                                                             std::string algo) {
-  std::vector<double> x, y;
-  for (int i{1}; i <= j; ++i) {
-    auto data = read_csv("./data/in/dataset_" + std::to_string(i) + ".csv");
-    const auto start{std::chrono::steady_clock::now()};
+std::size_t parse_size(const std::string &spec) {
+  std::size_t pos{0};
+  const double value = std::stod(spec, &pos);
+  std::size_t unit{1};
+  if (pos < spec.size()) {
+    switch (spec[pos]) {
+    case 'K':
+    case 'k':
+      unit = std::size_t{1} << 10;
+      break;
+    case 'M':
+    case 'm':
+      unit = std::size_t{1} << 20;
+      break;
+    case 'G':
+    case 'g':
+      unit = std::size_t{1} << 30;
+      break;
+    }
+  }
+  return static_cast<std::size_t>(value * unit);
+}
 
-    if (algo == "insertion_sort")
-      insertion_sort(data.begin(), data.end(), std::less<Soldier>());
-    else if (algo == "shaker_sort")
-      shaker_sort(data.begin(), data.end(), std::less<Soldier>());
-    else if (algo == "merge_sort")
-      merge_sort(data.begin(), data.end(), std::less<Soldier>());
-    else if (algo == "std::sort")
-      std::sort(data.begin(), data.end(), std::less<Soldier>());
+/**
+ * @brief Сравнить samplesort() с другими сортировками
+ *
+ * Использование: samplesort [потоки]. Каждый датасет сортируется
+ * записями Soldier и нормализованными ключами: uint64_t из номера
+ * подразделения (в порядке строк) и зарплаты, так что пара (unit,
+ * salary) сравнивается одним целым. Для std::sort,
+ * std::sort(std::execution::par), merge_sort(), parallel_merge_sort(),
+ * samplesort() и parallel_samplesort() выводятся время и пик памяти
+ * кучи за сортировку (сверх входных данных); неупорядоченный результат
+ * помечается UNSORTED. Параллельный std::sort libstdc++ работает через
+ * TBB, если тот установлен (тогда нужна линковка с -ltbb), иначе
+ * последовательно - это выводится как par_backend.
+ *
+ * @return код возврата программы
+ */
+int run_samplesort(int argc, char *argv[]) {
+  const unsigned threads =
+      argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+  Scheduler sched(threads);
+  heap_usage.enable();
+#if defined(_PSTL_PAR_BACKEND_TBB)
+  const char *par_backend = "tbb";
+#else
+  const char *par_backend = "serial";
+#endif
+  std::cout << "samplesort: threads=" << sched.size()
+            << " par_backend=" << par_backend << "\n";
 
-    const auto finish{std::chrono::steady_clock::now()};
-    const std::chrono::duration<double> elapsed_seconds{finish - start};
-    x.push_back(data.size());
-    y.push_back(elapsed_seconds.count());
+  auto bench = [&](const char *what, int i, const auto &input, auto comp) {
+    std::cout << "samplesort: " << what << " dataset_n=" << i
+              << " size=" << input.size();
+    auto run = [&](const char *name, auto sort) {
+      auto keys = input;
+      heap_usage.reset_peak();
+      const std::int64_t before = heap_usage.current();
+      const auto start{std::chrono::steady_clock::now()};
+      sort(keys);
+      const auto finish{std::chrono::steady_clock::now()};
+      const std::chrono::duration<double> elapsed_seconds{finish - start};
+      std::cout << ' ' << name << '=' << elapsed_seconds.count() << " ("
+                << heap_usage.peak() - before << " heap)"
+                << (std::is_sorted(keys.begin(), keys.end(), comp)
+                        ? ""
+                        : " UNSORTED");
+    };
+    run("std::sort",
+        [&](auto &keys) { std::sort(keys.begin(), keys.end(), comp); });
+    run("std::sort(par)", [&](auto &keys) {
+      std::sort(std::execution::par, keys.begin(), keys.end(), comp);
+    });
+    run("merge_sort",
+        [&](auto &keys) { merge_sort(keys.begin(), keys.end(), comp); });
+    run("parallel_merge_sort", [&](auto &keys) {
+      parallel_merge_sort(sched, keys.begin(), keys.end(), comp);
+    });
+    run("samplesort",
+        [&](auto &keys) { samplesort(keys.begin(), keys.end(), comp); });
+    run("parallel_samplesort", [&](auto &keys) {
+      parallel_samplesort(sched, keys.begin(), keys.end(), comp);
+    });
+    std::cout << "\n";
+  };
 
-    write_csv("data/out/insertion/dataset_" + std::to_string(i) + ".csv", data);
+  for (int i{1}; i <= 15; ++i) {
+    const auto data =
+        read_csv("./data/in/dataset_" + std::to_string(i) + ".csv");
+    std::vector<std::string> units;
+    for (const auto &s : data)
+      units.push_back(s.unit);
+    std::sort(units.begin(), units.end());
+    units.erase(std::unique(units.begin(), units.end()), units.end());
+    std::vector<std::uint64_t> keys;
+    keys.reserve(data.size());
+    for (const auto &s : data) {
+      const auto unit = std::lower_bound(units.begin(), units.end(), s.unit);
+      // Инверсия знакового бита сохраняет порядок зарплат в uint32_t
+      const std::uint32_t salary =
+          static_cast<std::uint32_t>(s.salary) ^ 0x80000000u;
+      keys.push_back(std::uint64_t(unit - units.begin()) << 32 | salary);
+    }
+    bench("records", i, data, std::less<Soldier>());
+    bench("keys", i, keys, std::less<std::uint64_t>());
+  }
+  return 0;
+}
 
-    // std::cout << "insertion_sort: iter=" << i << " done\n";
+/**
+ * @brief Самопроверка сортировок и форматов на синтетических данных
+ *
+ * Использование: check. Датасеты не нужны. samplesort() и
+ * parallel_samplesort() сравниваются с std::sort на случайных входах,
+ * входах с большим числом повторов и уже упорядоченных (по возрастанию
+ * и по убыванию) - записями Soldier и целыми ключами, на длинах от
+ * пустой до нескольких уровней рекурсии. Таблица со столбцами всех
+ * типов (пустые и не-ASCII строки, крайние int32, отрицательные
+ * decimal) пишется write_arrow() файлом и потоком в переставленном
+ * порядке, читается read_arrow() и сравнивается со схемой и строками
+ * исходной; так же проверяется пустая таблица. Для каждой проверки
+ * выводится ok либо FAIL.
+ *
+ * @return 0, если все проверки прошли, иначе 1
+ */
+int run_check() {
+  bool passed = true;
+  auto report = [&](const std::string &what, bool ok) {
+    std::cout << "check: " << what << (ok ? " ok" : " FAIL") << "\n";
+    passed = passed && ok;
+  };
 
-    std::cout << algo + ": dataset_n=" << i << " size=" << data.size()
-              << " time=" << y.at(i - 1) << "\n";
+  Scheduler sched(4);
+  std::mt19937_64 gen(1);
+  const std::vector<std::string> units{"alpha", "bravo", "charlie", "delta"};
+  // Вход вида kind длины n: элемент с ключом k строит make(k)
+  auto make_input = [&](const std::string &kind, std::size_t n, auto make,
+                        auto comp) {
+    std::vector<decltype(make(0))> data;
+    data.reserve(n);
+    for (std::size_t i{0}; i < n; ++i)
+      data.push_back(make(kind == "duplicates" ? gen() % 4 : gen()));
+    if (kind == "sorted")
+      std::sort(data.begin(), data.end(), comp);
+    else if (kind == "reversed")
+      std::sort(data.begin(), data.end(),
+                [&](const auto &a, const auto &b) { return comp(b, a); });
+    return data;
+  };
+  auto key = [](std::uint64_t k) { return k; };
+  auto record = [&](std::uint64_t k) {
+    return Soldier("name_" + std::to_string(k % 1000), "job",
+                   units[k / 1000 % units.size()],
+                   static_cast<int>(k >> 40) - (1 << 23));
+  };
+  // Результаты совпадают, если на каждом месте элементы эквивалентны
+  auto same_order = [](const auto &a, const auto &b, auto comp) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(),
+                      [&](const auto &x, const auto &y) {
+                        return !comp(x, y) && !comp(y, x);
+                      });
+  };
+  auto check_sorts = [&](const std::string &what, const auto &input,
+                         auto comp) {
+    auto expected = input;
+    std::sort(expected.begin(), expected.end(), comp);
+    auto serial = input;
+    samplesort(serial.begin(), serial.end(), comp);
+    auto parallel = input;
+    parallel_samplesort(sched, parallel.begin(), parallel.end(), comp);
+    report("samplesort " + what, same_order(serial, expected, comp));
+    report("parallel_samplesort " + what,
+           same_order(parallel, expected, comp));
+  };
+
+  for (std::string kind : {"random", "duplicates", "sorted", "reversed"}) {
+    for (std::size_t n : {0, 1, 31, 1000, 100000, 1 << 20}) {
+      const std::string what = kind + " n=" + std::to_string(n);
+      check_sorts("keys " + what,
+                  make_input(kind, n, key, std::less<std::uint64_t>()),
+                  std::less<std::uint64_t>());
+      if (n <= 100000)
+        check_sorts("records " + what,
+                    make_input(kind, n, record, std::less<Soldier>()),
+                    std::less<Soldier>());
+    }
   }
 
-  return {x, y};
+  Table table(*parse_schema("name:string,unit:dict,n:int,price:decimal(2)"));
+  auto add_row = [&](const std::vector<std::string> &fields) {
+    for (std::size_t c{0}; c < fields.size(); ++c)
+      std::visit([&](auto &col) { col.push_back(fields[c]); },
+                 table.columns[c]);
+    ++table.rows;
+  };
+  add_row({"", "charlie", "-2147483648", "-92233720368547758.08"});
+  add_row({"Иванов Иван", "alpha", "2147483647", "92233720368547758.07"});
+  add_row({"x", "", "0", "-0.05"});
+  for (int r{0}; r < 5000; ++r) {
+    const auto k = gen();
+    add_row({"name_" + std::to_string(k % 1000), units[k % units.size()],
+             std::to_string(static_cast<std::int32_t>(k >> 32)),
+             std::to_string(static_cast<std::int32_t>(k)) + ".5"});
+  }
+  for (auto &column : table.columns) {
+    if (auto *d = std::get_if<DictionaryColumn>(&column))
+      d->dict.finalize(d->codes);
+  }
+  Table empty(table.schema);
+
+  const auto tmp = std::filesystem::temp_directory_path() / "lab1_check";
+  for (const Table *t : {&table, &empty}) {
+    const auto perm = build_permutation(*t, *parse_table_key(*t, "unit,n"));
+    for (auto format : {ArrowFormat::file, ArrowFormat::stream}) {
+      const bool file = format == ArrowFormat::file;
+      const std::string out = tmp.string() + (file ? ".arrow" : ".arrows");
+      bool ok = write_arrow(out, *t, perm, format);
+      const auto back = ok ? read_arrow(out) : std::nullopt;
+      ok = back && back->rows == t->rows &&
+           back->schema.size() == t->schema.size();
+      for (std::size_t c{0}; ok && c < t->schema.size(); ++c)
+        ok = back->schema[c].name == t->schema[c].name &&
+             back->schema[c].type == t->schema[c].type &&
+             back->schema[c].scale == t->schema[c].scale;
+      for (std::uint32_t r{0}; ok && r < t->rows; ++r)
+        ok = table_row(*back, r) == table_row(*t, perm[r]);
+      std::remove(out.c_str());
+      report(std::string("arrow ") + (file ? "file" : "stream") +
+                 " rows=" + std::to_string(t->rows),
+             ok);
+    }
+  }
+  return passed ? 0 : 1;
+}
+
+/**
+ * @brief Отсортировать датасеты, не выходя за ограничение памяти
+ *
+ * Каждый датасет сортируется budget_sort() в data/out/budget/. Для
+ * каждого выводится выбранный способ, число отрезков и проходов
+ * слияния, время и пик памяти кучи за время сортировки (сверх уже
+ * занятой до неё) против ограничения; превышение помечается OVER.
+ * Ниже ~100 КБ постоянные расходы (буферы потоков, открытые отрезки)
+ * уже не укладываются в ограничение.
+ *
+ * @param limit ограничение памяти в байтах
+ * @return код возврата программы
+ */
+int run_mem_limit(std::size_t limit) {
+  heap_usage.enable();
+  std::system("rm -rf data/out/budget/ && mkdir -p data/out/budget/");
+  for (int i{1}; i <= 15; ++i) {
+    const std::string name = "dataset_" + std::to_string(i) + ".csv";
+    heap_usage.reset_peak();
+    const std::int64_t before = heap_usage.current();
+
+    const auto start{std::chrono::steady_clock::now()};
+    const auto stats = budget_sort("./data/in/" + name,
+                                   "./data/out/budget/" + name, limit,
+                                   "./data/out/budget/run_");
+    const auto finish{std::chrono::steady_clock::now()};
+    const std::chrono::duration<double> elapsed_seconds{finish - start};
+
+    const auto peak = static_cast<std::size_t>(heap_usage.peak() - before);
+    lab_metrics().heap_peak_bytes.set(peak);
+    std::cout << "mem-limit: dataset_n=" << i << " size=" << stats.rows
+              << " plan=" << plan_name(stats.plan) << " runs=" << stats.runs
+              << " merge_passes=" << stats.merge_passes
+              << " time=" << elapsed_seconds.count() << " peak_heap=" << peak
+              << " limit=" << limit << (peak <= limit ? "" : " OVER") << "\n";
+  }
+  return 0;
 }
 
 /**
  * @brief основная функция программы
  *
- * Считывание данных из датасетов, замер времени различных сортировок,
- * запись отсортированных данных, постройка графиков
+ * Без аргументов: считывание данных из датасетов, замер времени различных
+ * сортировок, запись отсортированных данных, постройка графиков.
+ * С аргументом "orderings" - см. run_orderings(), "join" - см. run_join(),
+ * "setop" - см. run_setop(), "dedup" - см. run_dedup(),
+ * "range" - см. run_range(), "bitmap" - см. run_bitmap(),
+ * "select" - см. run_select(), "sketch" - см. run_sketch(),
+ * "names" - см. run_names(), "io" - см. run_io(), "runs" - см. run_runs(),
+ * "pod" - см. run_pod(), "dispatch" - см. run_dispatch(),
+ * "roofline" - см. run_roofline(), "sched" - см. run_sched(),
+ * "table" - см. run_table(), "arrow" - см. run_arrow(),
+ * "samplesort" - см. run_samplesort(), "check" - см. run_check().
+ * Флаг --direct в режиме по умолчанию читает и пишет датасеты мимо кэша
+ * страниц (IoMode::direct), --budget=<сек> задаёт ограничение времени
+ * одного запуска сортировки (по умолчанию 2 с, 0 - без ограничения);
+ * время прерванных запусков оценивается, см. get_time();
+ * --metrics=<файл> (в любом режиме) раз в 5 секунд и в конце выгружает
+ * метрики (строки, байты, длительности сортировок, выделения памяти,
+ * глубину очередей планировщика) в текстовом формате Prometheus, см.
+ * MetricsRegistry::dump();
+ * --mem-limit=<размер> (например, 64M) вместо замеров сортирует датасеты
+ * с ограничением памяти, см. run_mem_limit()
  */
-int main() {
+int main(int argc, char *argv[]) {
+  // --metrics= действует в любом режиме, поэтому разбирается до выбора
+  // режима и убирается из argv, чтобы не мешать позиционным аргументам
+  std::optional<MetricsDumper> dumper;
+  int kept{1};
+  for (int a{1}; a < argc; ++a) {
+    const std::string arg = argv[a];
+    if (arg.rfind("--metrics=", 0) == 0)
+      dumper.emplace(arg.substr(sizeof("--metrics=") - 1),
+                     std::chrono::seconds(5));
+    else
+      argv[kept++] = argv[a];
+  }
+  argc = kept;
+  argv[argc] = nullptr;
+  lab_metrics();
+
+  if (argc > 1 && std::string(argv[1]) == "orderings") {
+    return run_orderings(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "join") {
+    return run_join(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "setop") {
+    return run_setop(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "dedup") {
+    return run_dedup();
+  }
+  if (argc > 1 && std::string(argv[1]) == "range") {
+    return run_range(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "bitmap") {
+    return run_bitmap();
+  }
+  if (argc > 1 && std::string(argv[1]) == "select") {
+    return run_select();
+  }
+  if (argc > 1 && std::string(argv[1]) == "sketch") {
+    return run_sketch(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "names") {
+    return run_names(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "io") {
+    return run_io(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "runs") {
+    return run_runs(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "pod") {
+    return run_pod();
+  }
+  if (argc > 1 && std::string(argv[1]) == "dispatch") {
+    return run_dispatch();
+  }
+  if (argc > 1 && std::string(argv[1]) == "roofline") {
+    return run_roofline(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "sched") {
+    return run_sched(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "table") {
+    return run_table(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "arrow") {
+    return run_arrow();
+  }
+  if (argc > 1 && std::string(argv[1]) == "samplesort") {
+    return run_samplesort(argc, argv);
+  }
+  if (argc > 1 && std::string(argv[1]) == "check") {
+    return run_check();
+  }
+  IoMode io = IoMode::buffered;
+  double budget{2.0};
+  std::size_t mem_limit{0};
+  for (int a{1}; a < argc; ++a) {
+    const std::string arg = argv[a];
+    if (arg == "--direct")
+      io = IoMode::direct;
+    else if (arg.rfind("--budget=", 0) == 0)
+      budget = std::stod(arg.substr(sizeof("--budget=") - 1));
+    else if (arg.rfind("--mem-limit=", 0) == 0)
+      mem_limit = parse_size(arg.substr(sizeof("--mem-limit=") - 1));
+  }
+  if (mem_limit > 0) {
+    return run_mem_limit(mem_limit);
+  }
 
   std::system("rm -rf data/out/ && mkdir data/out/ data/out/insertion/ "
               "data/out/shaker/ data/out/merge/ data/out/sort/ data/out/plots/ "
               "data/out/plots/svg/ data/out/plots/jpg/");
 
-  auto insertion_time{get_time(6, "insertion_sort")};
+  std::vector<std::string> files;
+  for (int i{1}; i <= 15; ++i) {
+    files.push_back("./data/in/dataset_" + std::to_string(i) + ".csv");
+  }
+  const auto load_start{std::chrono::steady_clock::now()};
+  std::vector<std::vector<Soldier>> datasets;
+  {
+    Scheduler sched;
+    datasets = load_datasets(sched, files, io);
+  }
+  const std::chrono::duration<double> load_seconds{
+      std::chrono::steady_clock::now() - load_start};
+  std::cout << "load: datasets=" << datasets.size()
+            << " time=" << load_seconds.count() << "\n";
+
+  auto insertion_time{get_time(datasets, "insertion_sort", io, budget)};
 
-  auto shaker_time{get_time(6, "shaker_sort")};
+  auto shaker_time{get_time(datasets, "shaker_sort", io, budget)};
 
-  auto merge_time{get_time(15, "merge_sort")};
+  auto merge_time{get_time(datasets, "merge_sort", io, budget)};
 
-  auto stdsort_time{get_time(15, "std::sort")};
+  auto stdsort_time{get_time(datasets, "std::sort", io)};
 
   auto y1 = insertion_time.second;
   auto y2 = shaker_time.second;
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm> // std::is_sorted, std::min, std::max
+#include <bit>       // std::bit_width
+#include <cstdint>   // std::uint32_t
+#include <fstream>   // std::ifstream, std::ofstream
+#include <iostream>  // std::cerr
+#include <limits>    // std::numeric_limits
+#include <numeric>   // std::iota
+#include <string>    // std::string, std::getline
+#include <utility>   // std::pair
+#include <vector>    // std::vector
+
+#include "columns.h" // SoldierColumns, build_permutation, to_columns
+#include "soldier.h" // Soldier, split
+#include "sorts.h"   // merge_sort
+
+/**
+ * @brief Строка справочника подразделений
+ */
+struct Unit {
+  std::string unit;      ///< Подразделение (ключ соединения)
+  std::string commander; ///< ФИО командира
+  std::string location;  ///< Место дислокации
+};
+
+/**
+ * @brief Считать справочник подразделений
+ * @param filename имя файла (строки вида "подразделение,командир,место")
+ * @return Вектор строк справочника
+ */
+inline std::vector<Unit> read_units_csv(const std::string &filename) {
+  std::vector<Unit> units;
+  std::ifstream ifile(filename);
+  std::string line;
+
+  if (!ifile.is_open()) {
+    std::cerr << "read_units_csv: Couldn't open file\n";
+  }
+
+  while (std::getline(ifile, line)) {
+    std::vector<std::string> fields_v = split(line, ',');
+    units.push_back({fields_v[0], fields_v[1], fields_v[2]});
+  }
+
+  return units;
+}
+
+/// Результат соединения: пары (номер военнослужащего, номер подразделения)
+using JoinResult = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+/// Код, означающий отсутствие подразделения в словаре датасета
+inline constexpr std::uint32_t no_code =
+    std::numeric_limits<std::uint32_t>::max();
+
+/**
+ * @brief Перевести ключи справочника в коды словаря подразделений датасета
+ * @return Код для каждой строки справочника либо no_code
+ */
+inline std::vector<std::uint32_t> unit_codes(const SoldierColumns &cols,
+                                             const std::vector<Unit> &units) {
+  std::vector<std::uint32_t> codes;
+  codes.reserve(units.size());
+  for (const auto &u : units) {
+    auto it = cols.units.index.find(u.unit);
+    codes.push_back(it == cols.units.index.end() ? no_code : it->second);
+  }
+  return codes;
+}
+
+/**
+ * @brief Соединение хешированием
+ *
+ * Ключом служит код словаря подразделений, а не строка, поэтому
+ * "хеш-таблица" - это плотный массив списков, индексируемый кодом.
+ * Таблица строится по меньшей из двух сторон, другая сторона
+ * просматривается один раз.
+ *
+ * @param cols датасет военнослужащих
+ * @param units справочник подразделений
+ * @return Пары совпавших строк, в порядке просмотра пробной стороны
+ */
+inline JoinResult hash_join(const SoldierColumns &cols,
+                            const std::vector<Unit> &units) {
+  JoinResult out;
+  const auto codes = unit_codes(cols, units);
+  std::vector<std::vector<std::uint32_t>> table(cols.units.values.size());
+
+  if (units.size() <= cols.size()) {
+    for (std::uint32_t r{0}; r < units.size(); ++r) {
+      if (codes[r] != no_code)
+        table[codes[r]].push_back(r);
+    }
+    out.reserve(cols.size());
+    for (std::uint32_t l{0}; l < cols.size(); ++l) {
+      for (auto r : table[cols.unit[l]]) {
+        out.emplace_back(l, r);
+      }
+    }
+  } else {
+    for (std::uint32_t l{0}; l < cols.size(); ++l) {
+      table[cols.unit[l]].push_back(l);
+    }
+    for (std::uint32_t r{0}; r < units.size(); ++r) {
+      if (codes[r] == no_code)
+        continue;
+      for (auto l : table[codes[r]]) {
+        out.emplace_back(l, r);
+      }
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Соединение слиянием отсортированных входов
+ *
+ * Уже упорядоченные по ключу стороны не сортируются повторно; иначе
+ * порядок строится через build_permutation() и merge_sort().
+ *
+ * @param cols датасет военнослужащих
+ * @param units справочник подразделений
+ * @return Пары совпавших строк в порядке возрастания ключа
+ */
+inline JoinResult merge_join(const SoldierColumns &cols,
+                             const std::vector<Unit> &units) {
+  JoinResult out;
+  const auto codes = unit_codes(cols, units);
+
+  std::vector<std::uint32_t> left(cols.size());
+  std::iota(left.begin(), left.end(), 0);
+  if (!std::is_sorted(cols.unit.begin(), cols.unit.end())) {
+    left = build_permutation(cols, {Field::unit});
+  }
+
+  std::vector<std::uint32_t> right(units.size());
+  std::iota(right.begin(), right.end(), 0);
+  if (right.size() > 1 && !std::is_sorted(codes.begin(), codes.end())) {
+    merge_sort(right.begin(), right.end(),
+               [&](auto a, auto b) { return codes[a] < codes[b]; });
+  }
+
+  std::size_t i{0}, j{0};
+  out.reserve(cols.size());
+  while (i < left.size() && j < right.size()) {
+    const auto lk = cols.unit[left[i]];
+    const auto rk = codes[right[j]];
+    if (lk < rk) {
+      ++i;
+    } else if (rk < lk) {
+      ++j;
+    } else {
+      auto j_end = j;
+      while (j_end < right.size() && codes[right[j_end]] == lk) {
+        ++j_end;
+      }
+      for (; i < left.size() && cols.unit[left[i]] == lk; ++i) {
+        for (auto k = j; k < j_end; ++k) {
+          out.emplace_back(left[i], right[k]);
+        }
+      }
+      j = j_end;
+    }
+  }
+  return out;
+}
+
+/// Способ соединения
+enum class JoinPlan { hash, merge };
+
+/// Название способа соединения
+inline const char *join_plan_name(JoinPlan plan) {
+  return plan == JoinPlan::merge ? "merge" : "hash";
+}
+
+/**
+ * @brief Выбрать способ соединения по размерам и упорядоченности входов
+ *
+ * Стоимости оцениваются в условных операциях над строками; веса
+ * подобраны по замерам run_join (на упорядоченных входах проход
+ * merge_join() через перестановки в ~1.4 раза дороже пробы hash_join()):
+ * - hash_join(): 4 на вставку строки меньшей стороны в список, 2 на
+ *   пробу строкой большей, 1 на каждый из codes списков таблицы;
+ * - merge_join(): 3 на строку каждой стороны плюс n log2 n на
+ *   сортировку каждой неупорядоченной стороны из n строк.
+ * Поэтому при плотных кодах (словарь подразделений много меньше
+ * датасета) хеширование выгоднее даже для упорядоченных входов, а
+ * слияние выбирается, когда обе стороны упорядочены (или не
+ * упорядочена лишь крошечная) и пространство кодов разреженное -
+ * словарь сравним со стороной, и массив списков дороже прохода. Если
+ * сортировать нужно большую сторону, всегда выигрывает хеширование.
+ *
+ * @param left_rows строк датасета
+ * @param left_sorted упорядочен ли датасет по ключу
+ * @param right_rows строк справочника
+ * @param right_sorted упорядочен ли справочник по ключу
+ * @param codes размер словаря ключей (число списков таблицы)
+ */
+inline JoinPlan plan_join(std::size_t left_rows, bool left_sorted,
+                          std::size_t right_rows, bool right_sorted,
+                          std::size_t codes) {
+  auto sort_cost = [](std::size_t n, bool sorted) -> std::size_t {
+    return sorted ? 0 : n * std::bit_width(n);
+  };
+  const std::size_t merge_cost = 3 * (left_rows + right_rows) +
+                                 sort_cost(left_rows, left_sorted) +
+                                 sort_cost(right_rows, right_sorted);
+  const std::size_t hash_cost = 4 * std::min(left_rows, right_rows) +
+                                2 * std::max(left_rows, right_rows) + codes;
+  return merge_cost <= hash_cost ? JoinPlan::merge : JoinPlan::hash;
+}
+
+/// Способ соединения датасета cols со справочником units
+inline JoinPlan plan_join(const SoldierColumns &cols,
+                          const std::vector<Unit> &units) {
+  const auto codes = unit_codes(cols, units);
+  return plan_join(cols.size(),
+                   std::is_sorted(cols.unit.begin(), cols.unit.end()),
+                   units.size(), std::is_sorted(codes.begin(), codes.end()),
+                   cols.units.values.size());
+}
+
+/**
+ * @brief Соединить датасет со справочником подразделений
+ *
+ * Способ - merge_join() или hash_join() - выбирается по размерам и
+ * упорядоченности сторон, см. plan_join().
+ */
+inline JoinResult join(const SoldierColumns &cols,
+                       const std::vector<Unit> &units) {
+  if (plan_join(cols, units) == JoinPlan::merge) {
+    return merge_join(cols, units);
+  }
+  return hash_join(cols, units);
+}
+
+/**
+ * @brief Соединить строки датасета со справочником подразделений
+ *
+ * Строки переводятся в столбцы (to_columns) - это копия данных; номера
+ * в результате - номера строк data.
+ */
+inline JoinResult join(const std::vector<Soldier> &data,
+                       const std::vector<Unit> &units) {
+  return join(to_columns(data), units);
+}
+
+/**
+ * @brief Записать результат соединения в .csv файл
+ * @param filename имя файла
+ * @param cols датасет военнослужащих
+ * @param units справочник подразделений
+ * @param rows пары совпавших строк
+ */
+inline void write_csv(const std::string &filename, const SoldierColumns &cols,
+                      const std::vector<Unit> &units, const JoinResult &rows) {
+  std::ofstream ofile(filename);
+  if (!ofile.is_open()) {
+    std::cerr << "write_csv: Couldn't open file\n";
+  }
+  for (auto [l, r] : rows) {
+    ofile << cols.full_name[l] << ',' << cols.jobs.values[cols.job[l]] << ','
+          << cols.units.values[cols.unit[l]] << ',' << cols.salary[l] << ','
+          << units[r].commander << ',' << units[r].location << '\n';
+  }
+}
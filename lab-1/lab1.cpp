@@ -0,0 +1,331 @@
+#include <algorithm>   // std::copy
+#include <cstdint>     // std::int32_t, std::int64_t, std::uint32_t
+#include <fstream>     // std::ifstream
+#include <functional>  // std::less
+#include <new>         // std::bad_alloc
+#include <numeric>     // std::iota
+#include <stdexcept>   // std::invalid_argument, std::out_of_range
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <type_traits> // std::is_same_v, std::decay_t
+#include <variant>     // std::variant, std::visit
+#include <vector>      // std::vector
+
+#define LAB1_BUILD
+#include "lab1.h" // C-интерфейс
+
+#include "arrow_ipc.h"   // read_arrow, write_arrow
+#include "sort_engine.h" // sort_by
+#include "sorts.h"       // insertion_sort, shaker_sort, merge_sort
+#include "table.h"       // Table, read_table, write_table
+
+/// Таблица C-интерфейса
+struct lab1_table {
+  Table table; ///< Таблица со схемой
+};
+
+namespace {
+
+/**
+ * @brief Выполнить f, переведя исключения в коды возврата
+ *
+ * Исключения C++ не должны выходить за границу C-интерфейса.
+ */
+template <class F> lab1_status guarded(F f) noexcept {
+  try {
+    return f();
+  } catch (const std::bad_alloc &) {
+    return LAB1_ENOMEM;
+  } catch (const std::invalid_argument &) {
+    return LAB1_EFORMAT;
+  } catch (const std::out_of_range &) {
+    return LAB1_EFORMAT;
+  } catch (...) {
+    return LAB1_EINTERNAL;
+  }
+}
+
+/// Сортировка массива вызывающего выбранным алгоритмом
+template <class T>
+lab1_status sort_values(T *values, std::size_t n, lab1_algorithm algorithm) {
+  if (values == nullptr && n > 0)
+    return LAB1_EINVAL;
+  if (n < 2)
+    return LAB1_OK;
+  return guarded([&] {
+    switch (algorithm) {
+    case LAB1_AUTO:
+      sort_by(values, values + n);
+      return LAB1_OK;
+    case LAB1_MERGE:
+      merge_sort(values, values + n, std::less<T>());
+      return LAB1_OK;
+    case LAB1_INSERTION:
+      insertion_sort(values, values + n, std::less<T>());
+      return LAB1_OK;
+    case LAB1_SHAKER:
+      shaker_sort(values, values + n, std::less<T>());
+      return LAB1_OK;
+    }
+    return LAB1_EINVAL;
+  });
+}
+
+/// Столбец чисел в памяти вызывающего
+template <class T> struct ValueView {
+  const T *values;
+
+  bool less(std::uint32_t a, std::uint32_t b) const {
+    return values[a] < values[b];
+  }
+  bool equal(std::uint32_t a, std::uint32_t b) const {
+    return values[a] == values[b];
+  }
+};
+
+/// Столбец строк в памяти вызывающего (символы и концы строк)
+struct Utf8View {
+  const char *chars;
+  const std::uint32_t *ends;
+
+  std::string_view operator[](std::uint32_t r) const {
+    const std::uint32_t begin = r == 0 ? 0 : ends[r - 1];
+    return {chars + begin, ends[r] - begin};
+  }
+  bool less(std::uint32_t a, std::uint32_t b) const {
+    return (*this)[a] < (*this)[b];
+  }
+  bool equal(std::uint32_t a, std::uint32_t b) const {
+    return (*this)[a] == (*this)[b];
+  }
+};
+
+using ColumnView =
+    std::variant<ValueView<std::int32_t>, ValueView<std::int64_t>,
+                 ValueView<std::uint32_t>, Utf8View>;
+
+/// Перестановка в perm вызывающего: 0..rows-1, затем уточнение по ключу
+template <class Columns>
+void sort_into(const Columns &columns, const std::vector<std::size_t> &key,
+               std::size_t rows, std::uint32_t *perm) {
+  std::iota(perm, perm + rows, 0u);
+  if (rows > 1 && !key.empty())
+    detail::refine_permutation(columns, key, 0, perm, perm + rows);
+}
+
+/// Порядок строк: perm вызывающего либо исходный
+std::vector<std::uint32_t> order_of(const lab1_table *table,
+                                    const std::uint32_t *perm) {
+  const std::size_t rows = table->table.rows;
+  std::vector<std::uint32_t> order(rows);
+  if (perm != nullptr)
+    std::copy(perm, perm + rows, order.begin());
+  else
+    std::iota(order.begin(), order.end(), 0u);
+  return order;
+}
+
+/// Проверить, что перестановка perm - номера строк таблицы
+bool valid_order(const lab1_table *table, const std::uint32_t *perm) {
+  for (std::size_t r{0}; perm != nullptr && r < table->table.rows; ++r) {
+    if (perm[r] >= table->table.rows)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+extern "C" {
+
+int lab1_api_version(void) { return LAB1_API_VERSION; }
+
+const char *lab1_status_string(lab1_status status) {
+  switch (status) {
+  case LAB1_OK:
+    return "ok";
+  case LAB1_EINVAL:
+    return "invalid argument";
+  case LAB1_EIO:
+    return "i/o error";
+  case LAB1_EFORMAT:
+    return "malformed input";
+  case LAB1_ENOMEM:
+    return "out of memory";
+  case LAB1_EINTERNAL:
+    return "internal error";
+  }
+  return "unknown status";
+}
+
+lab1_status lab1_sort_i32(int32_t *values, size_t n,
+                          lab1_algorithm algorithm) {
+  return sort_values(values, n, algorithm);
+}
+
+lab1_status lab1_sort_i64(int64_t *values, size_t n,
+                          lab1_algorithm algorithm) {
+  return sort_values(values, n, algorithm);
+}
+
+lab1_status lab1_sort_permutation(const lab1_column *key, size_t n_key,
+                                  size_t rows, uint32_t *perm) {
+  if ((key == nullptr && n_key > 0) || (perm == nullptr && rows > 0) ||
+      rows > UINT32_MAX)
+    return LAB1_EINVAL;
+  return guarded([&] {
+    std::vector<ColumnView> columns;
+    std::vector<std::size_t> order;
+    for (std::size_t c{0}; c < n_key; ++c) {
+      const lab1_column &k = key[c];
+      if (k.values == nullptr && rows > 0)
+        return LAB1_EINVAL;
+      switch (k.type) {
+      case LAB1_COL_I32:
+        columns.emplace_back(
+            ValueView<std::int32_t>{static_cast<const int32_t *>(k.values)});
+        break;
+      case LAB1_COL_I64:
+        columns.emplace_back(
+            ValueView<std::int64_t>{static_cast<const int64_t *>(k.values)});
+        break;
+      case LAB1_COL_DICT:
+        columns.emplace_back(ValueView<std::uint32_t>{
+            static_cast<const uint32_t *>(k.values)});
+        break;
+      case LAB1_COL_UTF8:
+        if (k.ends == nullptr && rows > 0)
+          return LAB1_EINVAL;
+        columns.emplace_back(
+            Utf8View{static_cast<const char *>(k.values), k.ends});
+        break;
+      default:
+        return LAB1_EINVAL;
+      }
+      order.push_back(c);
+    }
+    sort_into(columns, order, rows, perm);
+    return LAB1_OK;
+  });
+}
+
+lab1_status lab1_table_read_csv(const char *path, const char *schema,
+                                lab1_table **out) {
+  if (path == nullptr || out == nullptr)
+    return LAB1_EINVAL;
+  *out = nullptr;
+  return guarded([&] {
+    const auto s = schema ? parse_schema(schema) : soldier_schema();
+    if (!s)
+      return LAB1_EINVAL;
+    if (!std::ifstream(path).is_open())
+      return LAB1_EIO;
+    *out = new lab1_table{read_table(path, *s)};
+    return LAB1_OK;
+  });
+}
+
+lab1_status lab1_table_read_arrow(const char *path, lab1_table **out) {
+  if (path == nullptr || out == nullptr)
+    return LAB1_EINVAL;
+  *out = nullptr;
+  return guarded([&] {
+    if (!std::ifstream(path).is_open())
+      return LAB1_EIO;
+    auto table = read_arrow(path);
+    if (!table)
+      return LAB1_EFORMAT;
+    *out = new lab1_table{std::move(*table)};
+    return LAB1_OK;
+  });
+}
+
+void lab1_table_free(lab1_table *table) { delete table; }
+
+size_t lab1_table_rows(const lab1_table *table) {
+  return table ? table->table.rows : 0;
+}
+
+size_t lab1_table_columns(const lab1_table *table) {
+  return table ? table->table.columns.size() : 0;
+}
+
+const char *lab1_table_column_name(const lab1_table *table, size_t c) {
+  if (table == nullptr || c >= table->table.schema.size())
+    return nullptr;
+  return table->table.schema[c].name.c_str();
+}
+
+lab1_status lab1_table_column(const lab1_table *table, size_t c,
+                              lab1_column *out) {
+  if (table == nullptr || out == nullptr || c >= table->table.columns.size())
+    return LAB1_EINVAL;
+  std::visit(
+      [&](const auto &col) {
+        using Col = std::decay_t<decltype(col)>;
+        *out = lab1_column{};
+        if constexpr (std::is_same_v<Col, StringColumn>) {
+          *out = {LAB1_COL_UTF8, col.chars.data(), col.ends.data(), 0};
+        } else if constexpr (std::is_same_v<Col, DictionaryColumn>) {
+          *out = {LAB1_COL_DICT, col.codes.data(), nullptr, 0};
+        } else if constexpr (std::is_same_v<Col, IntColumn>) {
+          *out = {LAB1_COL_I32, col.values.data(), nullptr, 0};
+        } else {
+          *out = {LAB1_COL_I64, col.values.data(), nullptr, col.scale};
+        }
+      },
+      table->table.columns[c]);
+  return LAB1_OK;
+}
+
+lab1_status lab1_table_dictionary(const lab1_table *table, size_t c,
+                                  uint32_t code, const char **data,
+                                  size_t *size) {
+  if (table == nullptr || data == nullptr || size == nullptr ||
+      c >= table->table.columns.size())
+    return LAB1_EINVAL;
+  const auto *col = std::get_if<DictionaryColumn>(&table->table.columns[c]);
+  if (col == nullptr || code >= col->dict.values.size())
+    return LAB1_EINVAL;
+  *data = col->dict.values[code].data();
+  *size = col->dict.values[code].size();
+  return LAB1_OK;
+}
+
+lab1_status lab1_table_sort(const lab1_table *table, const char *key,
+                            uint32_t *perm) {
+  if (table == nullptr || key == nullptr ||
+      (perm == nullptr && table->table.rows > 0))
+    return LAB1_EINVAL;
+  return guarded([&] {
+    const auto k = parse_table_key(table->table, key);
+    if (!k)
+      return LAB1_EINVAL;
+    sort_into(table->table.columns, *k, table->table.rows, perm);
+    return LAB1_OK;
+  });
+}
+
+lab1_status lab1_table_write_csv(const lab1_table *table, const char *path,
+                                 const uint32_t *perm) {
+  if (table == nullptr || path == nullptr || !valid_order(table, perm))
+    return LAB1_EINVAL;
+  return guarded([&] {
+    return write_table(path, table->table, order_of(table, perm)) ? LAB1_OK
+                                                                  : LAB1_EIO;
+  });
+}
+
+lab1_status lab1_table_write_arrow(const lab1_table *table, const char *path,
+                                   const uint32_t *perm, int stream) {
+  if (table == nullptr || path == nullptr || !valid_order(table, perm))
+    return LAB1_EINVAL;
+  return guarded([&] {
+    const auto format = stream ? ArrowFormat::stream : ArrowFormat::file;
+    return write_arrow(path, table->table, order_of(table, perm), format)
+               ? LAB1_OK
+               : LAB1_EIO;
+  });
+}
+
+} // extern "C"
@@ -0,0 +1,194 @@
+/**
+ * @file lab1.h
+ * @brief C-интерфейс библиотеки сортировок и ввода-вывода датасетов
+ *
+ * Библиотека собирается build_lib.sh в liblab1.so и liblab1.a и
+ * подключается из C и C++ без зависимостей от заголовков реализации.
+ * Пример использования из C - lab1_check.c: build_lib.sh собирает его
+ * с обеими библиотеками и запускает как проверку интерфейса.
+ *
+ * Правила интерфейса:
+ * - исключения наружу не выходят; функции, которые могут не
+ *   выполниться, возвращают lab1_status, а простые доступы к таблице
+ *   (lab1_table_rows(), lab1_table_columns(), lab1_table_column_name())
+ *   на неверных аргументах возвращают 0 либо NULL;
+ * - сортировки работают в буферах вызывающего (на месте либо с
+ *   перестановкой в переданном массиве), данные не копируются;
+ * - строки передаются как в Arrow: символы подряд и концы строк
+ *   (ends[r] - конец строки r, начало - ends[r - 1] либо 0), так что
+ *   для столбца Arrow со смещениями offsets достаточно передать
+ *   offsets + 1;
+ * - таблицы (lab1_table) непрозрачны и освобождаются lab1_table_free();
+ *   lab1_table_column() отдаёт указатели на их внутренние буферы,
+ *   действительные до освобождения таблицы.
+ *
+ * Совместимость: новые функции и значения перечислений только
+ * добавляются, структуры не меняются; несовместимое изменение
+ * увеличивает LAB1_API_VERSION и soname.
+ */
+#ifndef LAB1_H
+#define LAB1_H
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* int32_t, int64_t, uint32_t */
+
+#if defined(LAB1_BUILD)
+#define LAB1_API __attribute__((visibility("default")))
+#else
+#define LAB1_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Версия интерфейса */
+#define LAB1_API_VERSION 1
+
+/** Код возврата */
+typedef enum lab1_status {
+  LAB1_OK = 0,      /**< Успех */
+  LAB1_EINVAL = 1,  /**< Неверный аргумент (NULL, неизвестный ключ...) */
+  LAB1_EIO = 2,     /**< Файл не открывается или не записывается */
+  LAB1_EFORMAT = 3, /**< Неверный формат входных данных */
+  LAB1_ENOMEM = 4,  /**< Не хватило памяти */
+  LAB1_EINTERNAL = 5 /**< Прочая ошибка */
+} lab1_status;
+
+/** Алгоритм сортировки массива */
+typedef enum lab1_algorithm {
+  LAB1_AUTO = 0,      /**< Поразрядная для целых (sort_by) */
+  LAB1_MERGE = 1,     /**< Сортировка слиянием (устойчивая) */
+  LAB1_INSERTION = 2, /**< Сортировка вставкой */
+  LAB1_SHAKER = 3     /**< Шейкер-сортировка */
+} lab1_algorithm;
+
+/** Тип столбца */
+typedef enum lab1_column_type {
+  LAB1_COL_I32 = 0,  /**< int32_t */
+  LAB1_COL_I64 = 1,  /**< int64_t (в том числе decimal, см. scale) */
+  LAB1_COL_DICT = 2, /**< Коды словаря uint32_t, упорядоченные как строки */
+  LAB1_COL_UTF8 = 3  /**< Строки: chars и ends */
+} lab1_column_type;
+
+/** Столбец в памяти вызывающего (или таблицы) */
+typedef struct lab1_column {
+  lab1_column_type type; /**< Тип */
+  const void *values;    /**< Значения; для LAB1_COL_UTF8 - символы */
+  const uint32_t *ends;  /**< Концы строк (только LAB1_COL_UTF8) */
+  int32_t scale;         /**< Знаков после точки (decimal), иначе 0 */
+} lab1_column;
+
+/** Непрозрачная таблица со схемой */
+typedef struct lab1_table lab1_table;
+
+/** Версия интерфейса собранной библиотеки */
+LAB1_API int lab1_api_version(void);
+
+/** Описание кода возврата */
+LAB1_API const char *lab1_status_string(lab1_status status);
+
+/**
+ * @brief Отсортировать массив int32_t на месте
+ * @param values массив
+ * @param n длина
+ * @param algorithm алгоритм
+ */
+LAB1_API lab1_status lab1_sort_i32(int32_t *values, size_t n,
+                                   lab1_algorithm algorithm);
+
+/** То же для int64_t */
+LAB1_API lab1_status lab1_sort_i64(int64_t *values, size_t n,
+                                   lab1_algorithm algorithm);
+
+/**
+ * @brief Построить перестановку, упорядочивающую строки по ключу
+ *
+ * Сортировка устойчивая, по возрастанию: по первому столбцу ключа,
+ * при равенстве - по второму и т.д. Столбцы не копируются.
+ *
+ * @param key столбцы ключа в порядке приоритета
+ * @param n_key число столбцов ключа
+ * @param rows число строк
+ * @param perm выход: rows номеров строк
+ */
+LAB1_API lab1_status lab1_sort_permutation(const lab1_column *key,
+                                           size_t n_key, size_t rows,
+                                           uint32_t *perm);
+
+/**
+ * @brief Прочитать .csv файл в таблицу
+ * @param path имя файла
+ * @param schema схема вида "name:string,unit:dict,salary:int,x:decimal(2)";
+ * NULL - схема датасетов военнослужащих
+ * @param out выход: таблица
+ */
+LAB1_API lab1_status lab1_table_read_csv(const char *path,
+                                         const char *schema,
+                                         lab1_table **out);
+
+/** Прочитать таблицу из файла или потока Arrow IPC */
+LAB1_API lab1_status lab1_table_read_arrow(const char *path,
+                                           lab1_table **out);
+
+/** Освободить таблицу (NULL допускается) */
+LAB1_API void lab1_table_free(lab1_table *table);
+
+/** Число строк таблицы */
+LAB1_API size_t lab1_table_rows(const lab1_table *table);
+
+/** Число столбцов таблицы */
+LAB1_API size_t lab1_table_columns(const lab1_table *table);
+
+/** Имя столбца c (строка с нулём в конце, живёт вместе с таблицей) */
+LAB1_API const char *lab1_table_column_name(const lab1_table *table,
+                                            size_t c);
+
+/**
+ * @brief Столбец таблицы без копирования
+ *
+ * Целые - LAB1_COL_I32, decimal - LAB1_COL_I64 со scale, словарные -
+ * LAB1_COL_DICT (строки словаря - lab1_table_dictionary()), прочие
+ * строки - LAB1_COL_UTF8.
+ */
+LAB1_API lab1_status lab1_table_column(const lab1_table *table, size_t c,
+                                       lab1_column *out);
+
+/**
+ * @brief Строка словаря столбца c с кодом code
+ * @param data выход: начало строки
+ * @param size выход: длина строки
+ */
+LAB1_API lab1_status lab1_table_dictionary(const lab1_table *table, size_t c,
+                                           uint32_t code, const char **data,
+                                           size_t *size);
+
+/**
+ * @brief Перестановка строк таблицы по ключу вида "unit,full_name,salary"
+ * @param perm выход: lab1_table_rows() номеров строк
+ */
+LAB1_API lab1_status lab1_table_sort(const lab1_table *table,
+                                     const char *key, uint32_t *perm);
+
+/**
+ * @brief Записать таблицу в .csv файл
+ * @param perm порядок строк (NULL - исходный)
+ */
+LAB1_API lab1_status lab1_table_write_csv(const lab1_table *table,
+                                          const char *path,
+                                          const uint32_t *perm);
+
+/**
+ * @brief Записать таблицу в формате Arrow IPC
+ * @param perm порядок строк (NULL - исходный)
+ * @param stream 0 - файл (.arrow), иначе поток (.arrows)
+ */
+LAB1_API lab1_status lab1_table_write_arrow(const lab1_table *table,
+                                            const char *path,
+                                            const uint32_t *perm, int stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LAB1_H */
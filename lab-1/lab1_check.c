@@ -0,0 +1,200 @@
+/**
+ * @file lab1_check.c
+ * @brief Проверка C-интерфейса библиотеки (lab1.h) из программы на C
+ *
+ * Собирается и запускается build_lib.sh со статической и с разделяемой
+ * библиотекой. Использование: lab1_check [каталог] - каталог для
+ * временных файлов (по умолчанию build). Для каждой проверки выводится
+ * ok либо FAIL; код возврата - число неудачных проверок.
+ */
+#include <stdint.h> /* int32_t, int64_t, uint32_t */
+#include <stdio.h>  /* printf, fopen, fread, snprintf, remove */
+#include <stdlib.h> /* qsort, srand, rand */
+#include <string.h> /* memcpy, memcmp, strcmp */
+
+#include "lab1.h" /* C-интерфейс */
+
+/** Число неудачных проверок */
+static int failed = 0;
+
+/** Вывести результат проверки */
+static void report(const char *what, int ok) {
+  printf("lab1_check: %s %s\n", what, ok ? "ok" : "FAIL");
+  failed += !ok;
+}
+
+/** Сравнения для qsort */
+static int compare_i32(const void *a, const void *b) {
+  const int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static int compare_i64(const void *a, const void *b) {
+  const int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/** Сортировки массивов всеми алгоритмами против qsort */
+static void check_sorts(void) {
+  enum { n = 1000 };
+  static int32_t v[n], v_expected[n];
+  static int64_t w[n], w_expected[n];
+  const lab1_algorithm algorithms[] = {LAB1_AUTO, LAB1_MERGE,
+                                       LAB1_INSERTION, LAB1_SHAKER};
+  char what[64];
+  size_t a, i;
+
+  for (a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); ++a) {
+    srand(1);
+    for (i = 0; i < n; ++i) {
+      /* отрицательные значения и повторы */
+      v[i] = rand() % 2001 - 1000;
+      w[i] = (int64_t)(rand() - RAND_MAX / 2) * 4294967311LL;
+    }
+    memcpy(v_expected, v, sizeof(v));
+    memcpy(w_expected, w, sizeof(w));
+    qsort(v_expected, n, sizeof(v[0]), compare_i32);
+    qsort(w_expected, n, sizeof(w[0]), compare_i64);
+
+    snprintf(what, sizeof(what), "sort_i32 algorithm=%d", (int)algorithms[a]);
+    report(what, lab1_sort_i32(v, n, algorithms[a]) == LAB1_OK &&
+                     memcmp(v, v_expected, sizeof(v)) == 0);
+    snprintf(what, sizeof(what), "sort_i64 algorithm=%d", (int)algorithms[a]);
+    report(what, lab1_sort_i64(w, n, algorithms[a]) == LAB1_OK &&
+                     memcmp(w, w_expected, sizeof(w)) == 0);
+  }
+}
+
+/** Перестановка по столбцам в памяти вызывающего */
+static void check_permutation(void) {
+  /* строки: (1, bob), (0, alice), (1, amy), (0, bob) */
+  const uint32_t unit[] = {1, 0, 1, 0};
+  const char chars[] = "bobaliceamybob";
+  const uint32_t ends[] = {3, 8, 11, 14};
+  const lab1_column key[] = {{LAB1_COL_DICT, unit, NULL, 0},
+                             {LAB1_COL_UTF8, chars, ends, 0}};
+  const uint32_t expected[] = {1, 3, 2, 0};
+  uint32_t perm[4];
+
+  report("sort_permutation",
+         lab1_sort_permutation(key, 2, 4, perm) == LAB1_OK &&
+             memcmp(perm, expected, sizeof(perm)) == 0);
+}
+
+/** Прочитать файл целиком в buffer (не больше size байт), -1 при ошибке */
+static long read_file(const char *path, char *buffer, size_t size) {
+  FILE *f = fopen(path, "rb");
+  size_t got;
+  if (f == NULL)
+    return -1;
+  got = fread(buffer, 1, size, f);
+  fclose(f);
+  return (long)got;
+}
+
+/** Таблица: чтение .csv, сортировка, запись и чтение Arrow IPC */
+static void check_table(const char *dir) {
+  const char text[] = "Petrov,private,B,100\n"
+                      "Ivanov,sergeant,A,300\n"
+                      "Abramov,private,B,-5\n"
+                      "Sidorov,captain,A,300\n";
+  const char sorted[] = "Ivanov,sergeant,A,300\n"
+                        "Sidorov,captain,A,300\n"
+                        "Abramov,private,B,-5\n"
+                        "Petrov,private,B,100\n";
+  const uint32_t expected[] = {1, 3, 2, 0};
+  char csv[256], out[256], arrow[256], buffer[256];
+  lab1_table *table = NULL, *back = NULL;
+  lab1_column column;
+  uint32_t perm[4];
+  const char *unit;
+  size_t unit_size;
+  int stream;
+  FILE *f;
+
+  snprintf(csv, sizeof(csv), "%s/lab1_check.csv", dir);
+  snprintf(out, sizeof(out), "%s/lab1_check_out.csv", dir);
+  f = fopen(csv, "w");
+  if (f == NULL) {
+    report("table write input", 0);
+    return;
+  }
+  fputs(text, f);
+  fclose(f);
+
+  report("table_read_csv",
+         lab1_table_read_csv(csv, NULL, &table) == LAB1_OK &&
+             lab1_table_rows(table) == 4 && lab1_table_columns(table) == 4 &&
+             strcmp(lab1_table_column_name(table, 2), "unit") == 0);
+  if (table == NULL) {
+    remove(csv);
+    return;
+  }
+
+  report("table_sort",
+         lab1_table_sort(table, "unit,full_name,salary", perm) == LAB1_OK &&
+             memcmp(perm, expected, sizeof(perm)) == 0);
+  report("table_column",
+         lab1_table_column(table, 3, &column) == LAB1_OK &&
+             column.type == LAB1_COL_I32 &&
+             ((const int32_t *)column.values)[2] == -5);
+  report("table_dictionary",
+         lab1_table_column(table, 2, &column) == LAB1_OK &&
+             column.type == LAB1_COL_DICT &&
+             lab1_table_dictionary(table, 2,
+                                   ((const uint32_t *)column.values)[perm[0]],
+                                   &unit, &unit_size) == LAB1_OK &&
+             unit_size == 1 && unit[0] == 'A');
+  report("table_write_csv",
+         lab1_table_write_csv(table, out, perm) == LAB1_OK &&
+             read_file(out, buffer, sizeof(buffer)) ==
+                 (long)sizeof(sorted) - 1 &&
+             memcmp(buffer, sorted, sizeof(sorted) - 1) == 0);
+
+  /* запись в порядке perm и чтение обратно дают отсортированную таблицу */
+  for (stream = 0; stream <= 1; ++stream) {
+    snprintf(arrow, sizeof(arrow), "%s/lab1_check.%s", dir,
+             stream ? "arrows" : "arrow");
+    report(stream ? "arrow stream round trip" : "arrow file round trip",
+           lab1_table_write_arrow(table, arrow, perm, stream) == LAB1_OK &&
+               lab1_table_read_arrow(arrow, &back) == LAB1_OK &&
+               lab1_table_write_csv(back, out, NULL) == LAB1_OK &&
+               read_file(out, buffer, sizeof(buffer)) ==
+                   (long)sizeof(sorted) - 1 &&
+               memcmp(buffer, sorted, sizeof(sorted) - 1) == 0);
+    lab1_table_free(back);
+    back = NULL;
+    remove(arrow);
+  }
+
+  report("error unknown key",
+         lab1_table_sort(table, "unit,rank", perm) == LAB1_EINVAL);
+  report("error not arrow",
+         lab1_table_read_arrow(csv, &back) == LAB1_EFORMAT && back == NULL);
+  lab1_table_free(table);
+  remove(csv);
+  remove(out);
+}
+
+int main(int argc, char *argv[]) {
+  const char *dir = argc > 1 ? argv[1] : "build";
+  lab1_table *table = NULL;
+
+  report("api_version", lab1_api_version() == LAB1_API_VERSION);
+  check_sorts();
+  check_permutation();
+  check_table(dir);
+
+  report("error null array", lab1_sort_i32(NULL, 5, LAB1_AUTO) == LAB1_EINVAL);
+  report("error missing file",
+         lab1_table_read_csv("lab1_check_missing.csv", NULL, &table) ==
+                 LAB1_EIO &&
+             table == NULL);
+  report("error bad schema",
+         lab1_table_read_csv(dir, "a:float", &table) == LAB1_EINVAL &&
+             table == NULL);
+  report("error bad decimal scale",
+         lab1_table_read_csv(dir, "a:decimal()", &table) == LAB1_EINVAL &&
+             table == NULL);
+  return failed;
+}
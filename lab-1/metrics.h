@@ -0,0 +1,502 @@
+#pragma once
+
+#include <algorithm>          // std::stable_sort
+#include <array>              // std::array
+#include <atomic>             // std::atomic
+#include <chrono>             // std::chrono::milliseconds
+#include <condition_variable> // std::condition_variable
+#include <cstdint>            // std::uint64_t, std::int64_t
+#include <cstdio>             // std::rename
+#include <deque>              // std::deque
+#include <fstream>            // std::ofstream
+#include <initializer_list>   // std::initializer_list
+#include <iostream>           // std::cerr
+#include <mutex>              // std::mutex, std::lock_guard
+#include <ostream>            // std::ostream
+#include <string>             // std::string
+#include <thread>             // std::thread
+#include <utility>            // std::move
+#include <vector>             // std::vector
+
+/// Число шардов у счётчиков и гистограмм
+inline constexpr std::size_t metric_shards = 16;
+
+/**
+ * @brief Шард текущего потока
+ *
+ * Потоки получают номера по порядку первого обращения, так что
+ * до metric_shards потоков пишут каждый в свою строку кэша.
+ */
+inline std::size_t shard_index() {
+  static constinit std::atomic<std::size_t> next{0};
+  thread_local const std::size_t idx =
+      next.fetch_add(1, std::memory_order_relaxed) % metric_shards;
+  return idx;
+}
+
+/**
+ * @brief Монотонный счётчик, разбитый на шарды по потокам
+ *
+ * add() - одно неупорядоченное (relaxed) атомарное сложение в строке
+ * кэша своего потока, без разделения строки с другими потоками;
+ * value() суммирует шарды и вызывается только при выгрузке.
+ * Конструктор constexpr, так что счётчик можно объявить глобальным и
+ * использовать до начала main (например, в operator new).
+ */
+class Counter {
+public:
+  constexpr Counter() = default;
+
+  /// Прибавить n
+  void add(std::uint64_t n = 1) {
+    shards[shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /// Текущее значение
+  std::uint64_t value() const {
+    std::uint64_t v{0};
+    for (const auto &s : shards)
+      v += s.value.load(std::memory_order_relaxed);
+    return v;
+  }
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> value{0};
+  };
+  std::array<Shard, metric_shards> shards{};
+};
+
+/**
+ * @brief Текущее значение величины (глубина очереди, размер кучи)
+ */
+class Gauge {
+public:
+  /// Установить значение
+  void set(std::int64_t v) { current.store(v, std::memory_order_relaxed); }
+
+  /// Изменить значение на d
+  void add(std::int64_t d) {
+    current.fetch_add(d, std::memory_order_relaxed);
+  }
+
+  /// Текущее значение
+  std::int64_t value() const {
+    return current.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<std::int64_t> current{0};
+};
+
+/**
+ * @brief Величина, которую приращениями меняют многие потоки
+ *
+ * Как Counter, разбита на шарды по потокам: add() - одно relaxed-
+ * сложение в строке кэша своего потока, value() суммирует шарды (сумма
+ * может быть отрицательной в отдельном шарде, но не в целом). Подходит
+ * для глубины очереди задач, которую меняет каждый spawn() и запуск
+ * задачи: общий Gauge стал бы одной строкой кэша на все потоки.
+ */
+class ShardedGauge {
+public:
+  constexpr ShardedGauge() = default;
+
+  /// Изменить значение на d
+  void add(std::int64_t d) {
+    shards[shard_index()].value.fetch_add(d, std::memory_order_relaxed);
+  }
+
+  /// Текущее значение
+  std::int64_t value() const {
+    std::int64_t v{0};
+    for (const auto &s : shards)
+      v += s.value.load(std::memory_order_relaxed);
+    return v;
+  }
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<std::int64_t> value{0};
+  };
+  std::array<Shard, metric_shards> shards{};
+};
+
+/**
+ * @brief Гистограмма с фиксированными границами корзин
+ *
+ * Как и Counter, разбита на шарды по потокам; observe() - поиск
+ * корзины среди не более чем max_buckets границ и два атомарных
+ * сложения.
+ */
+class Histogram {
+public:
+  static constexpr std::size_t max_buckets = 16;
+
+  /// @param bounds возрастающие верхние границы корзин (+Inf добавляется)
+  explicit Histogram(std::initializer_list<double> bounds) {
+    for (double b : bounds) {
+      if (n_bounds < max_buckets)
+        upper[n_bounds++] = b;
+    }
+  }
+
+  /// Учесть значение
+  void observe(double v) {
+    std::size_t b{0};
+    while (b < n_bounds && v > upper[b])
+      ++b;
+    auto &s = shards[shard_index()];
+    s.buckets[b].fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(v, std::memory_order_relaxed);
+  }
+
+  /// Число значений в корзине b (b == bounds() - корзина +Inf)
+  std::uint64_t bucket(std::size_t b) const {
+    std::uint64_t v{0};
+    for (const auto &s : shards)
+      v += s.buckets[b].load(std::memory_order_relaxed);
+    return v;
+  }
+
+  /// Сумма всех значений
+  double sum() const {
+    double v{0};
+    for (const auto &s : shards)
+      v += s.sum.load(std::memory_order_relaxed);
+    return v;
+  }
+
+  /// Число границ (без +Inf)
+  std::size_t bounds() const { return n_bounds; }
+
+  /// Верхняя граница корзины b
+  double bound(std::size_t b) const { return upper[b]; }
+
+private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<std::uint64_t>, max_buckets + 1> buckets{};
+    std::atomic<double> sum{0};
+  };
+  std::array<double, max_buckets> upper{};
+  std::size_t n_bounds{0};
+  std::array<Shard, metric_shards> shards{};
+};
+
+/**
+ * @brief Набор именованных метрик с выгрузкой в текстовом формате Prometheus
+ *
+ * Метрики создаются один раз (обычно в статической переменной) и дальше
+ * обновляются без обращения к реестру. Повторный запрос метрики с теми
+ * же именем и метками возвращает ту же метрику.
+ */
+class MetricsRegistry {
+public:
+  /**
+   * @brief Счётчик
+   * @param name имя (для счётчиков принято окончание _total)
+   * @param help описание
+   * @param labels метки в формате Prometheus, например algorithm="merge"
+   */
+  Counter &counter(const std::string &name, const std::string &help,
+                   const std::string &labels = "") {
+    std::lock_guard lock(mutex);
+    if (auto *e = find(name, labels))
+      return *e->counter;
+    entries.push_back({"counter", name, help, labels,
+                       &owned_counters.emplace_back(), nullptr, nullptr,
+                       nullptr});
+    return *entries.back().counter;
+  }
+
+  /// Учесть счётчик, созданный вне реестра (например, глобальный)
+  void attach(Counter &c, const std::string &name, const std::string &help,
+              const std::string &labels = "") {
+    std::lock_guard lock(mutex);
+    if (!find(name, labels))
+      entries.push_back(
+          {"counter", name, help, labels, &c, nullptr, nullptr, nullptr});
+  }
+
+  /// Учесть разбитую на шарды величину, созданную вне реестра
+  void attach(ShardedGauge &g, const std::string &name,
+              const std::string &help, const std::string &labels = "") {
+    std::lock_guard lock(mutex);
+    if (!find(name, labels))
+      entries.push_back(
+          {"gauge", name, help, labels, nullptr, nullptr, nullptr, &g});
+  }
+
+  /// Величина (см. counter())
+  Gauge &gauge(const std::string &name, const std::string &help,
+               const std::string &labels = "") {
+    std::lock_guard lock(mutex);
+    if (auto *e = find(name, labels))
+      return *e->gauge;
+    entries.push_back({"gauge", name, help, labels, nullptr,
+                       &owned_gauges.emplace_back(), nullptr, nullptr});
+    return *entries.back().gauge;
+  }
+
+  /// Гистограмма (см. counter())
+  Histogram &histogram(const std::string &name, const std::string &help,
+                       std::initializer_list<double> bounds,
+                       const std::string &labels = "") {
+    std::lock_guard lock(mutex);
+    if (auto *e = find(name, labels))
+      return *e->histogram;
+    entries.push_back({"histogram", name, help, labels, nullptr, nullptr,
+                       &owned_histograms.emplace_back(bounds), nullptr});
+    return *entries.back().histogram;
+  }
+
+  /// Вывести все метрики в текстовом формате Prometheus
+  void write_text(std::ostream &os) const {
+    std::lock_guard lock(mutex);
+    std::vector<const Entry *> sorted;
+    for (const auto &e : entries)
+      sorted.push_back(&e);
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](auto a, auto b) { return a->name < b->name; });
+
+    const std::string *last = nullptr;
+    for (const auto *e : sorted) {
+      if (!last || *last != e->name) {
+        os << "# HELP " << e->name << ' ' << e->help << '\n'
+           << "# TYPE " << e->name << ' ' << e->type << '\n';
+        last = &e->name;
+      }
+      if (e->counter) {
+        os << e->name << braces(e->labels) << ' ' << e->counter->value()
+           << '\n';
+      } else if (e->gauge) {
+        os << e->name << braces(e->labels) << ' ' << e->gauge->value()
+           << '\n';
+      } else if (e->sharded) {
+        os << e->name << braces(e->labels) << ' ' << e->sharded->value()
+           << '\n';
+      } else {
+        const auto &h = *e->histogram;
+        const std::string sep = e->labels.empty() ? "" : ",";
+        std::uint64_t cumulative{0};
+        for (std::size_t b{0}; b <= h.bounds(); ++b) {
+          cumulative += h.bucket(b);
+          os << e->name << "_bucket{" << e->labels << sep << "le=\"";
+          if (b < h.bounds())
+            os << h.bound(b);
+          else
+            os << "+Inf";
+          os << "\"} " << cumulative << '\n';
+        }
+        os << e->name << "_sum" << braces(e->labels) << ' ' << h.sum() << '\n'
+           << e->name << "_count" << braces(e->labels) << ' ' << cumulative
+           << '\n';
+      }
+    }
+  }
+
+  /**
+   * @brief Записать метрики в файл для textfile collector node_exporter
+   *
+   * Пишется во временный файл рядом и переименовывается, чтобы
+   * сборщик никогда не прочитал файл наполовину.
+   *
+   * @param filename имя файла (обычно *.prom)
+   */
+  void dump(const std::string &filename) const {
+    const std::string tmp = filename + ".tmp";
+    {
+      std::ofstream ofile(tmp);
+      if (!ofile.is_open()) {
+        std::cerr << "MetricsRegistry::dump: Couldn't open file\n";
+        return;
+      }
+      write_text(ofile);
+    }
+    std::rename(tmp.c_str(), filename.c_str());
+  }
+
+private:
+  struct Entry {
+    std::string type, name, help, labels;
+    Counter *counter;
+    Gauge *gauge;
+    Histogram *histogram;
+    ShardedGauge *sharded;
+  };
+
+  mutable std::mutex mutex;
+  std::deque<Entry> entries;
+  std::deque<Counter> owned_counters;
+  std::deque<Gauge> owned_gauges;
+  std::deque<Histogram> owned_histograms;
+
+  Entry *find(const std::string &name, const std::string &labels) {
+    for (auto &e : entries) {
+      if (e.name == name && e.labels == labels)
+        return &e;
+    }
+    return nullptr;
+  }
+
+  static std::string braces(const std::string &labels) {
+    return labels.empty() ? "" : "{" + labels + "}";
+  }
+};
+
+/// Общий реестр метрик программы
+inline MetricsRegistry &metrics() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+/// Число выделений памяти (считается в operator new, если он подменён)
+inline constinit Counter allocations;
+
+/// Байты, запрошенные у operator new
+inline constinit Counter allocated_bytes;
+
+/// Задачи, поставленные в планировщики и ещё не начатые (см. Scheduler)
+inline constinit ShardedGauge scheduler_queue_depth;
+
+/**
+ * @brief Объём занятой памяти кучи и его максимум
+ *
+ * В отличие от Counter не разбит на шарды: пик должен учитывать
+ * выделения всех потоков сразу, а это одна общая строка кэша на каждое
+ * выделение. Поэтому учёт выключен, пока его не включит enable() -
+ * только режимы, замеряющие пик памяти (--mem-limit, samplesort); в
+ * остальных operator new проверяет лишь редко меняемый флаг. Блоки,
+ * выделенные до enable(), при освобождении уменьшают объём, поэтому он
+ * знаковый и имеет смысл только как разность с current().
+ */
+class HeapUsage {
+public:
+  constexpr HeapUsage() = default;
+
+  /// Начать учёт выделений
+  void enable() { on.store(true, std::memory_order_relaxed); }
+
+  /// Включён ли учёт
+  bool enabled() const { return on.load(std::memory_order_relaxed); }
+
+  /// Учесть выделение n байт
+  void add(std::size_t n) {
+    const auto d = static_cast<std::int64_t>(n);
+    const std::int64_t now = live.fetch_add(d, std::memory_order_relaxed) + d;
+    std::int64_t high = max.load(std::memory_order_relaxed);
+    while (now > high &&
+           !max.compare_exchange_weak(high, now, std::memory_order_relaxed)) {
+    }
+  }
+
+  /// Учесть освобождение n байт
+  void sub(std::size_t n) {
+    live.fetch_sub(static_cast<std::int64_t>(n), std::memory_order_relaxed);
+  }
+
+  /// Занято сейчас (относительно момента enable())
+  std::int64_t current() const {
+    return live.load(std::memory_order_relaxed);
+  }
+
+  /// Максимум с начала учёта или последнего reset_peak()
+  std::int64_t peak() const { return max.load(std::memory_order_relaxed); }
+
+  /// Начать отсчёт максимума заново с текущего объёма
+  void reset_peak() {
+    max.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<bool> on{false};
+  std::atomic<std::int64_t> live{0};
+  std::atomic<std::int64_t> max{0};
+};
+
+/// Память кучи (учитывается в operator new/delete, если они подменены)
+inline constinit HeapUsage heap_usage;
+
+/**
+ * @brief Метрики чтения, записи и сортировки датасетов
+ */
+struct LabMetrics {
+  Counter &rows_parsed = metrics().counter(
+      "lab1_rows_parsed_total", "Rows parsed from dataset files");
+  Counter &bytes_read = metrics().counter("lab1_bytes_read_total",
+                                          "Bytes read from dataset files");
+  Counter &bytes_written = metrics().counter(
+      "lab1_bytes_written_total", "Bytes written to output files");
+  Gauge &run_heap_rows = metrics().gauge(
+      "lab1_run_heap_rows", "Rows held in the replacement-selection heap");
+  Gauge &heap_peak_bytes = metrics().gauge(
+      "lab1_heap_peak_bytes", "Peak heap usage of the last budgeted sort");
+
+  LabMetrics() {
+    metrics().attach(allocations, "lab1_allocations_total",
+                     "Calls to operator new");
+    metrics().attach(allocated_bytes, "lab1_allocated_bytes_total",
+                     "Bytes requested from operator new");
+    metrics().attach(scheduler_queue_depth, "lab1_scheduler_queue_depth",
+                     "Tasks queued in scheduler deques and injection queue");
+  }
+
+  /// Гистограмма длительности сортировок алгоритмом algo
+  Histogram &sort_seconds(const std::string &algo) {
+    return metrics().histogram(
+        "lab1_sort_duration_seconds", "Time to sort one dataset",
+        {1e-5, 1e-4, 1e-3, 0.01, 0.1, 0.5, 1, 2, 5, 10, 30, 100},
+        "algorithm=\"" + algo + "\"");
+  }
+};
+
+/// Метрики датасетов (создаются при первом обращении)
+inline LabMetrics &lab_metrics() {
+  static LabMetrics m;
+  return m;
+}
+
+/**
+ * @brief Периодическая выгрузка метрик в файл
+ *
+ * Фоновый поток раз в interval вызывает MetricsRegistry::dump();
+ * деструктор останавливает поток и делает последнюю выгрузку.
+ */
+class MetricsDumper {
+public:
+  MetricsDumper(std::string filename, std::chrono::milliseconds interval,
+                const MetricsRegistry &registry = metrics())
+      : filename(std::move(filename)), interval(interval),
+        registry(registry), worker([this] { loop(); }) {}
+
+  MetricsDumper(const MetricsDumper &) = delete;
+  MetricsDumper &operator=(const MetricsDumper &) = delete;
+
+  ~MetricsDumper() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    registry.dump(filename);
+  }
+
+private:
+  std::string filename;
+  std::chrono::milliseconds interval;
+  const MetricsRegistry &registry;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping{false};
+  std::thread worker;
+
+  void loop() {
+    std::unique_lock lock(mutex);
+    while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+      lock.unlock();
+      registry.dump(filename);
+      lock.lock();
+    }
+  }
+};
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>   // std::max
+#include <bit>         // std::countr_zero, std::bit_ceil
+#include <cstdint>     // std::int8_t, std::uint32_t, std::uint64_t
+#include <functional>  // std::hash
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <thread>      // std::thread
+#include <vector>      // std::vector
+
+#ifdef __SSE2__
+#include <emmintrin.h> // _mm_cmpeq_epi8, _mm_movemask_epi8
+#endif
+
+#include "sketch.h" // mix_hash
+
+/**
+ * @brief Хеш-индекс по ФИО с открытой адресацией
+ *
+ * Таблица устроена как SwissTable: слоты сгруппированы по 16, для
+ * каждого слота хранится управляющий байт (7 младших бит хеша или
+ * признак пустоты), так что группа проверяется одним SIMD-сравнением.
+ * В слоте лежат номер первой строки с данным ФИО и полный хеш, поэтому
+ * строки сравниваются только при совпадении хеша. Ключи не копируются -
+ * индекс ссылается на столбец ФИО датасета (std::string_view).
+ *
+ * ФИО не уникальны: остальные строки с тем же ФИО связаны в список
+ * через next().
+ *
+ * Таблица разбита на шарды по старшим битам хеша, шарды строятся
+ * параллельно независимыми потоками.
+ */
+class NameIndex {
+public:
+  /// Номер строки, означающий "не найдено"
+  static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+  /**
+   * @brief Построить индекс
+   * @param column столбец ФИО (должен жить дольше индекса)
+   * @param threads число потоков
+   */
+  NameIndex(const std::vector<std::string> &column, unsigned threads)
+      : names(&column), next_row(column.size(), npos), shards(shard_count) {
+    threads = std::max(1u, threads);
+
+    std::vector<std::uint64_t> hashes(column.size());
+    run_parallel(threads, column.size(), [&](std::size_t b, std::size_t e) {
+      for (auto i = b; i < e; ++i)
+        hashes[i] = hash_of(column[i]);
+    });
+
+    std::vector<std::vector<std::uint32_t>> by_shard(shard_count);
+    for (std::uint32_t i{0}; i < column.size(); ++i) {
+      by_shard[hashes[i] >> (64 - shard_bits)].push_back(i);
+    }
+
+    run_parallel(threads, shard_count, [&](std::size_t b, std::size_t e) {
+      for (auto s = b; s < e; ++s)
+        build_shard(shards[s], by_shard[s], hashes);
+    });
+  }
+
+  /**
+   * @brief Найти первую строку с данным ФИО
+   * @return номер строки либо npos
+   */
+  std::uint32_t find(std::string_view name) const {
+    return find_hashed(name, hash_of(name));
+  }
+
+  /// Следующая строка с тем же ФИО либо npos
+  std::uint32_t next(std::uint32_t row) const { return next_row[row]; }
+
+  /**
+   * @brief Найти несколько ФИО сразу
+   *
+   * Хеши считаются заранее, а группы таблицы для следующих ключей
+   * предзагружаются в кэш, пока обрабатываются текущие.
+   *
+   * @param keys искомые ФИО
+   * @param out номера первых строк (npos, если не найдено)
+   */
+  void find_batch(const std::vector<std::string_view> &keys,
+                  std::vector<std::uint32_t> &out) const {
+    constexpr std::size_t ahead{8};
+    std::vector<std::uint64_t> hashes(keys.size());
+    for (std::size_t i{0}; i < keys.size(); ++i)
+      hashes[i] = hash_of(keys[i]);
+
+    out.resize(keys.size());
+    for (std::size_t i{0}; i < keys.size(); ++i) {
+      if (i + ahead < keys.size()) {
+        const auto h = hashes[i + ahead];
+        const auto &s = shards[h >> (64 - shard_bits)];
+        __builtin_prefetch(&s.ctrl[first_group(s, h) * group]);
+      }
+      out[i] = find_hashed(keys[i], hashes[i]);
+    }
+  }
+
+  /// Занимаемая память в байтах (без самих строк)
+  std::size_t bytes() const {
+    std::size_t b = next_row.capacity() * sizeof(std::uint32_t);
+    for (const auto &s : shards) {
+      b += s.ctrl.capacity() + s.rows.capacity() * sizeof(std::uint32_t) +
+           s.hashes.capacity() * sizeof(std::uint64_t);
+    }
+    return b;
+  }
+
+private:
+  static constexpr unsigned shard_bits = 4;
+  static constexpr std::size_t shard_count = std::size_t{1} << shard_bits;
+  static constexpr std::size_t group = 16;
+  static constexpr std::int8_t empty = -128;
+
+  /// Часть таблицы; слоты с одинаковым номером в ctrl/rows/hashes
+  struct Shard {
+    std::vector<std::int8_t> ctrl;     ///< Управляющие байты
+    std::vector<std::uint32_t> rows;   ///< Первая строка с ФИО
+    std::vector<std::uint64_t> hashes; ///< Полный хеш ФИО
+    std::size_t group_mask{0};         ///< Число групп - 1
+  };
+
+  const std::vector<std::string> *names;
+  std::vector<std::uint32_t> next_row;
+  std::vector<Shard> shards;
+
+  static std::uint64_t hash_of(std::string_view s) {
+    return mix_hash(std::hash<std::string_view>()(s));
+  }
+
+  static std::int8_t h2(std::uint64_t h) {
+    return static_cast<std::int8_t>(h & 0x7f);
+  }
+
+  static std::size_t first_group(const Shard &s, std::uint64_t h) {
+    return (h >> 7) & s.group_mask;
+  }
+
+  /// Маска слотов группы, управляющий байт которых равен c
+  static std::uint32_t match(const std::int8_t *ctrl, std::int8_t c) {
+#ifdef __SSE2__
+    const auto g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+    return static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c))));
+#else
+    std::uint32_t mask{0};
+    for (std::size_t i{0}; i < group; ++i)
+      mask |= std::uint32_t{ctrl[i] == c} << i;
+    return mask;
+#endif
+  }
+
+  std::uint32_t find_hashed(std::string_view name, std::uint64_t h) const {
+    const auto &s = shards[h >> (64 - shard_bits)];
+    if (s.ctrl.empty())
+      return npos;
+    for (auto g = first_group(s, h);; g = (g + 1) & s.group_mask) {
+      const auto *ctrl = &s.ctrl[g * group];
+      for (auto m = match(ctrl, h2(h)); m != 0; m &= m - 1) {
+        const auto slot = g * group + std::countr_zero(m);
+        if (s.hashes[slot] == h && (*names)[s.rows[slot]] == name)
+          return s.rows[slot];
+      }
+      if (match(ctrl, empty) != 0)
+        return npos;
+    }
+  }
+
+  void build_shard(Shard &s, const std::vector<std::uint32_t> &rows,
+                   const std::vector<std::uint64_t> &hashes) {
+    const std::size_t groups = std::bit_ceil(rows.size() * 8 / 7 / group + 1);
+    s.group_mask = groups - 1;
+    s.ctrl.assign(groups * group, empty);
+    s.rows.assign(groups * group, npos);
+    s.hashes.assign(groups * group, 0);
+    std::vector<std::uint32_t> tail(groups * group, npos);
+
+    for (auto row : rows) {
+      const auto h = hashes[row];
+      for (auto g = first_group(s, h);; g = (g + 1) & s.group_mask) {
+        const auto *ctrl = &s.ctrl[g * group];
+        bool done = false;
+        for (auto m = match(ctrl, h2(h)); m != 0 && !done; m &= m - 1) {
+          const auto slot = g * group + std::countr_zero(m);
+          const auto first = s.rows[slot];
+          if (s.hashes[slot] == h && (*names)[first] == (*names)[row]) {
+            next_row[tail[slot]] = row;
+            tail[slot] = row;
+            done = true;
+          }
+        }
+        if (done)
+          break;
+        if (auto m = match(ctrl, empty); m != 0) {
+          const auto slot = g * group + std::countr_zero(m);
+          s.ctrl[slot] = h2(h);
+          s.rows[slot] = row;
+          s.hashes[slot] = h;
+          tail[slot] = row;
+          break;
+        }
+      }
+    }
+  }
+
+  /// Разбить [0, n) на части и обработать их параллельно
+  template <class F>
+  static void run_parallel(unsigned threads, std::size_t n, F f) {
+    std::vector<std::thread> workers;
+    for (unsigned t{0}; t < threads; ++t) {
+      workers.emplace_back(f, n * t / threads, n * (t + 1) / threads);
+    }
+    for (auto &w : workers)
+      w.join();
+  }
+};
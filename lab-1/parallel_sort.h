@@ -0,0 +1,37 @@
+#pragma once
+
+#include <iterator> // std::random_access_iterator
+
+#include "scheduler.h" // Scheduler, parallel_invoke
+#include "sorts.h"     // merge_sort, merge
+
+/**
+ * @brief Параллельная сортировка слиянием
+ *
+ * Половины сортируются параллельно задачами планировщика, пока части
+ * не станут меньше cutoff - дальше обычной merge_sort(). Слияние
+ * выполняется последовательно функцией merge() и пропускается, если
+ * половины уже упорядочены.
+ *
+ * @param sched планировщик
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param comp функция сравнения
+ * @param cutoff размер части, сортируемой последовательно
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void parallel_merge_sort(Scheduler &sched, RandomAccessIterator first,
+                         RandomAccessIterator last, Compare comp,
+                         std::size_t cutoff = 4096) {
+  if (static_cast<std::size_t>(last - first) <= cutoff) {
+    if (last - first > 1)
+      merge_sort(first, last, comp);
+    return;
+  }
+  const auto mid = first + (last - first) / 2;
+  parallel_invoke(
+      sched, [&] { parallel_merge_sort(sched, first, mid, comp, cutoff); },
+      [&] { parallel_merge_sort(sched, mid, last, comp, cutoff); });
+  if (comp(*mid, *(mid - 1)))
+    merge(first, mid, mid, last, comp);
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <bit>     // std::popcount, std::countr_zero, std::bit_width
+#include <cstdint> // std::int64_t, std::uint32_t, std::uint64_t
+#include <numeric> // std::iota
+#include <vector>  // std::vector
+
+#include "sorts.h" // merge_sort
+
+/**
+ * @brief Массив чисел фиксированной разрядности, упакованных в слова
+ */
+class PackedArray {
+public:
+  PackedArray() = default;
+
+  /**
+   * @brief Создать массив из n нулей
+   * @param n число элементов
+   * @param width разрядность элемента в битах (не больше 32)
+   */
+  PackedArray(std::size_t n, unsigned width)
+      : width(width), words((n * width + 63) / 64 + 1, 0) {}
+
+  /// Записать значение в позицию i (позиция должна быть нулевой)
+  void set(std::size_t i, std::uint64_t v) {
+    if (width == 0)
+      return;
+    const std::size_t bit = i * width;
+    words[bit / 64] |= v << (bit % 64);
+    if (bit % 64 + width > 64) {
+      words[bit / 64 + 1] |= v >> (64 - bit % 64);
+    }
+  }
+
+  /// Прочитать значение в позиции i
+  std::uint64_t get(std::size_t i) const {
+    if (width == 0)
+      return 0;
+    const std::size_t bit = i * width;
+    std::uint64_t v = words[bit / 64] >> (bit % 64);
+    if (bit % 64 + width > 64) {
+      v |= words[bit / 64 + 1] << (64 - bit % 64);
+    }
+    return v & ((std::uint64_t{1} << width) - 1);
+  }
+
+  /// Занимаемая память в байтах
+  std::size_t bytes() const { return words.size() * sizeof(std::uint64_t); }
+
+private:
+  unsigned width{0};
+  std::vector<std::uint64_t> words;
+};
+
+/**
+ * @brief Индекс диапазонов по зарплате
+ *
+ * Отсортированные зарплаты хранятся в кодировке Элиаса-Фано: младшие
+ * low_bits бит каждого значения - в упакованном массиве, старшие - в
+ * унарном виде в битовом векторе high (единица на элемент, ноль на
+ * каждую "корзину" старших бит). Рядом лежат номера строк в том же
+ * порядке, упакованные до ceil(log2 n) бит.
+ *
+ * Границы корзины ищутся через select0 по выборке каждого 256-го нуля
+ * за O(1) обращений к памяти, внутри корзины (младшие биты там
+ * упорядочены) - двоичным поиском. Поэтому граница диапазона стоит
+ * O(1 + log b), где b - число значений в корзине (в среднем не больше
+ * двух, но равные зарплаты попадают в одну корзину), а find() - ещё
+ * длину ответа.
+ */
+class SalaryIndex {
+public:
+  SalaryIndex() = default;
+
+  /**
+   * @brief Построить индекс по столбцу зарплат
+   * @param salary зарплата для каждой строки датасета
+   */
+  explicit SalaryIndex(const std::vector<int> &salary) : n(salary.size()) {
+    if (n == 0)
+      return;
+
+    std::vector<std::uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    if (n > 1) {
+      merge_sort(order.begin(), order.end(),
+                 [&](auto a, auto b) { return salary[a] < salary[b]; });
+    }
+
+    min_value = salary[order.front()];
+    const std::uint64_t universe =
+        static_cast<std::uint64_t>(std::int64_t{salary[order.back()]} -
+                                   std::int64_t{min_value}) +
+        1;
+    low_bits = universe > n ? std::bit_width(universe / n) - 1 : 0;
+
+    max_high = (universe - 1) >> low_bits;
+    low = PackedArray(n, low_bits);
+    rows = PackedArray(n, std::bit_width(n - 1));
+    const std::size_t high_len = n + (universe >> low_bits) + 1;
+    high.assign(high_len / 64 + 1, 0);
+
+    for (std::size_t i{0}; i < n; ++i) {
+      const std::uint64_t v = static_cast<std::uint64_t>(
+          std::int64_t{salary[order[i]]} - std::int64_t{min_value});
+      low.set(i, v & ((std::uint64_t{1} << low_bits) - 1));
+      const std::size_t pos = (v >> low_bits) + i;
+      high[pos / 64] |= std::uint64_t{1} << (pos % 64);
+      rows.set(i, order[i]);
+    }
+
+    std::size_t zeros{0};
+    for (std::size_t pos{0}; pos < high_len; ++pos) {
+      if (!(high[pos / 64] >> (pos % 64) & 1)) {
+        if (zeros % zero_sample == 0)
+          zero_samples.push_back(pos);
+        ++zeros;
+      }
+    }
+  }
+
+  /// Число строк с зарплатой в [lo, hi]
+  std::size_t count(int lo, int hi) const {
+    return lo > hi ? 0
+                   : lower_bound(std::int64_t{hi} + 1) - lower_bound(lo);
+  }
+
+  /// Номера строк с зарплатой в [lo, hi] (в порядке возрастания зарплаты)
+  std::vector<std::uint32_t> find(int lo, int hi) const {
+    std::vector<std::uint32_t> out;
+    if (lo > hi)
+      return out;
+    const auto first = lower_bound(lo);
+    const auto last = lower_bound(std::int64_t{hi} + 1);
+    out.reserve(last - first);
+    for (auto i = first; i < last; ++i) {
+      out.push_back(static_cast<std::uint32_t>(rows.get(i)));
+    }
+    return out;
+  }
+
+  /// Занимаемая память в байтах
+  std::size_t bytes() const {
+    return low.bytes() + rows.bytes() +
+           high.size() * sizeof(std::uint64_t) +
+           zero_samples.size() * sizeof(std::size_t);
+  }
+
+private:
+  static constexpr std::size_t zero_sample = 256;
+
+  std::size_t n{0};
+  int min_value{0};
+  unsigned low_bits{0};
+  std::size_t max_high{0};
+  PackedArray low;
+  PackedArray rows;
+  std::vector<std::uint64_t> high;
+  std::vector<std::size_t> zero_samples;
+
+  /// Позиция k-го (с нуля) нуля в high
+  std::size_t select0(std::size_t k) const {
+    std::size_t pos = zero_samples[k / zero_sample];
+    std::size_t left = k % zero_sample;
+    std::size_t w = pos / 64;
+    std::uint64_t word = ~high[w] & (~std::uint64_t{0} << (pos % 64));
+    while (true) {
+      const auto c = static_cast<std::size_t>(std::popcount(word));
+      if (left < c)
+        break;
+      left -= c;
+      word = ~high[++w];
+    }
+    for (; left > 0; --left) {
+      word &= word - 1;
+    }
+    return w * 64 + std::countr_zero(word);
+  }
+
+  /// Номер первого элемента со значением не меньше x
+  std::size_t lower_bound(std::int64_t x) const {
+    if (n == 0 || x <= min_value)
+      return 0;
+    const auto v = static_cast<std::uint64_t>(x - std::int64_t{min_value});
+    const std::size_t h = v >> low_bits;
+    if (h > max_high) {
+      return n;
+    }
+
+    // Корзина h - элементы между (h-1)-м и h-м нулями high
+    std::size_t first = h == 0 ? 0 : select0(h - 1) + 1 - h;
+    std::size_t last = select0(h) - h;
+    const std::uint64_t low_v = v & ((std::uint64_t{1} << low_bits) - 1);
+    while (first < last) {
+      const std::size_t mid = first + (last - first) / 2;
+      if (low.get(mid) < low_v)
+        first = mid + 1;
+      else
+        last = mid;
+    }
+    return first;
+  }
+};
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>  // std::min
+#include <cstdint>    // std::int32_t, std::uint8_t, std::uint32_t
+#include <cstdio>     // std::remove
+#include <fstream>    // std::ifstream, std::ofstream
+#include <functional> // std::less
+#include <iostream>   // std::cerr
+#include <memory>     // std::unique_ptr
+#include <optional>   // std::optional
+#include <queue>      // std::priority_queue
+#include <string>     // std::string, std::to_string
+#include <vector>     // std::vector
+
+#include "metrics.h" // lab_metrics
+#include "soldier.h" // Soldier, SoldierReader
+
+/**
+ * @brief Запись отсортированного отрезка во временный файл
+ *
+ * Формат компактнее .csv и не требует разбора: для каждой строки три
+ * поля-строки (длина varint + байты) и зарплата (4 байта).
+ */
+class RunWriter {
+public:
+  explicit RunWriter(const std::string &filename)
+      : ofile(filename, std::ios::binary) {
+    if (!ofile.is_open()) {
+      std::cerr << "RunWriter: Couldn't open file\n";
+    }
+  }
+
+  /// Дописать строку в конец отрезка
+  void write(const Soldier &s) {
+    put_string(s.full_name);
+    put_string(s.job);
+    put_string(s.unit);
+    const auto salary = static_cast<std::int32_t>(s.salary);
+    ofile.write(reinterpret_cast<const char *>(&salary), sizeof(salary));
+  }
+
+private:
+  std::ofstream ofile;
+
+  void put_string(const std::string &s) {
+    for (auto n = static_cast<std::uint32_t>(s.size());; n >>= 7) {
+      const auto byte = static_cast<std::uint8_t>(n & 0x7f);
+      if (n < 0x80) {
+        ofile.put(static_cast<char>(byte));
+        break;
+      }
+      ofile.put(static_cast<char>(byte | 0x80));
+    }
+    ofile.write(s.data(), s.size());
+  }
+};
+
+/**
+ * @brief Чтение отрезка, записанного RunWriter
+ */
+class RunReader {
+public:
+  explicit RunReader(const std::string &filename)
+      : ifile(filename, std::ios::binary) {
+    if (!ifile.is_open()) {
+      std::cerr << "RunReader: Couldn't open file\n";
+    }
+  }
+
+  /**
+   * @brief Считать следующую строку
+   * @param s объект, в который записывается строка
+   * @return false, если отрезок закончился
+   */
+  bool next(Soldier &s) {
+    std::int32_t salary{0};
+    if (!get_string(s.full_name) || !get_string(s.job) ||
+        !get_string(s.unit) ||
+        !ifile.read(reinterpret_cast<char *>(&salary), sizeof(salary))) {
+      return false;
+    }
+    s.salary = salary;
+    return true;
+  }
+
+private:
+  std::ifstream ifile;
+
+  bool get_string(std::string &s) {
+    std::uint32_t n{0};
+    for (unsigned shift{0};; shift += 7) {
+      const int c = ifile.get();
+      if (c == std::char_traits<char>::eof())
+        return false;
+      n |= static_cast<std::uint32_t>(c & 0x7f) << shift;
+      if (!(c & 0x80))
+        break;
+    }
+    s.resize(n);
+    return static_cast<bool>(ifile.read(s.data(), n));
+  }
+};
+
+/**
+ * @brief Оценка памяти, занимаемой строкой датасета
+ *
+ * Строки длиннее буфера малых строк (15 байт в libstdc++) лежат в куче.
+ */
+inline std::size_t record_bytes(const Soldier &s) {
+  auto heap = [](const std::string &str) {
+    return str.size() > 15 ? str.capacity() + 1 : 0;
+  };
+  return sizeof(Soldier) + heap(s.full_name) + heap(s.job) + heap(s.unit);
+}
+
+/// Итоги разбиения на отрезки
+struct RunStats {
+  std::vector<std::string> files;   ///< Имена файлов отрезков
+  std::vector<std::size_t> lengths; ///< Число строк в каждом отрезке
+  std::size_t heap_rows{0};         ///< Сколько строк помещалось в память
+};
+
+/**
+ * @brief Разбить поток строк на отсортированные отрезки выбором с замещением
+ *
+ * В памяти держится куча из строк, занимающих не больше memory_bytes.
+ * Наименьшая строка кучи дописывается в текущий отрезок, а на её место
+ * читается следующая строка входа; если она меньше только что
+ * записанной, она помечается для следующего отрезка. На случайных
+ * данных отрезки в среднем вдвое длиннее, чем помещается в память, на
+ * почти упорядоченных - намного длиннее (упорядоченный вход даёт один
+ * отрезок).
+ *
+ * @param filename входной датасет (.csv)
+ * @param prefix префикс имён файлов отрезков
+ * @param memory_bytes ограничение памяти под кучу
+ * @param comp функция сравнения
+ * @return Имена и длины отрезков
+ */
+template <class Compare = std::less<Soldier>>
+RunStats make_runs(const std::string &filename, const std::string &prefix,
+                   std::size_t memory_bytes, Compare comp = Compare()) {
+  struct Item {
+    std::size_t run;
+    Soldier row;
+  };
+  auto greater = [&](const Item &a, const Item &b) {
+    if (a.run != b.run)
+      return a.run > b.run;
+    return comp(b.row, a.row);
+  };
+  std::priority_queue<Item, std::vector<Item>, decltype(greater)> heap(
+      greater);
+
+  RunStats stats;
+  SoldierReader reader(filename);
+  Soldier s;
+  std::size_t used{0};
+  while (used < memory_bytes && reader.next(s)) {
+    used += record_bytes(s);
+    heap.push({0, std::move(s)});
+  }
+  stats.heap_rows = heap.size();
+  Gauge &heap_gauge = lab_metrics().run_heap_rows;
+
+  std::size_t current{0};
+  std::optional<RunWriter> writer;
+  while (!heap.empty()) {
+    Item top = heap.top();
+    heap.pop();
+    if (!writer || top.run != current) {
+      current = top.run;
+      stats.files.push_back(prefix + std::to_string(current) + ".run");
+      stats.lengths.push_back(0);
+      writer.emplace(stats.files.back());
+    }
+    writer->write(top.row);
+    ++stats.lengths.back();
+
+    if (reader.next(s)) {
+      const std::size_t run = comp(s, top.row) ? current + 1 : current;
+      heap.push({run, std::move(s)});
+    }
+    heap_gauge.set(heap.size());
+  }
+  return stats;
+}
+
+/// Память на один открытый отрезок при слиянии (буфер потока и строка)
+inline constexpr std::size_t run_reader_bytes = 16 * 1024;
+
+/**
+ * @brief Слить отрезки files в поток, вызывая emit для каждой строки
+ *
+ * Открыты все отрезки сразу: памяти нужно около run_reader_bytes на
+ * отрезок (см. reduce_runs).
+ *
+ * @param files отрезки, упорядоченные по comp
+ * @param emit вызывается для строк в порядке comp
+ * @param comp функция сравнения
+ */
+template <class Emit, class Compare = std::less<Soldier>>
+void merge_runs(const std::vector<std::string> &files, Emit emit,
+                Compare comp = Compare()) {
+  struct Head {
+    Soldier row;
+    std::size_t run;
+  };
+  auto greater = [&](const Head &a, const Head &b) {
+    return comp(b.row, a.row);
+  };
+  std::priority_queue<Head, std::vector<Head>, decltype(greater)> heap(
+      greater);
+  std::vector<std::unique_ptr<RunReader>> readers;
+  for (std::size_t r{0}; r < files.size(); ++r) {
+    readers.push_back(std::make_unique<RunReader>(files[r]));
+    Soldier s;
+    if (readers.back()->next(s))
+      heap.push({std::move(s), r});
+  }
+  while (!heap.empty()) {
+    Head top = heap.top();
+    heap.pop();
+    emit(top.row);
+    Soldier s;
+    if (readers[top.run]->next(s))
+      heap.push({std::move(s), top.run});
+  }
+}
+
+/**
+ * @brief Сократить число отрезков до fan_in промежуточными слияниями
+ *
+ * Пока отрезков больше fan_in, группы по fan_in сливаются в отрезки
+ * prefix + "p<проход>_<номер>.run", исходные файлы удаляются.
+ *
+ * @param files отрезки; заменяются на оставшиеся после слияний
+ * @param fan_in сколько отрезков можно открыть одновременно (не меньше 2)
+ * @param prefix префикс имён промежуточных отрезков
+ * @param comp функция сравнения
+ * @return Число проходов слияния
+ */
+template <class Compare = std::less<Soldier>>
+std::size_t reduce_runs(std::vector<std::string> &files, std::size_t fan_in,
+                        const std::string &prefix, Compare comp = Compare()) {
+  std::size_t pass{0};
+  for (; files.size() > fan_in; ++pass) {
+    std::vector<std::string> merged;
+    for (std::size_t b{0}; b < files.size(); b += fan_in) {
+      const std::vector<std::string> group(
+          files.begin() + b,
+          files.begin() + std::min(files.size(), b + fan_in));
+      merged.push_back(prefix + "p" + std::to_string(pass) + "_" +
+                       std::to_string(merged.size()) + ".run");
+      RunWriter writer(merged.back());
+      merge_runs(
+          group, [&](const Soldier &s) { writer.write(s); }, comp);
+      for (const auto &f : group)
+        std::remove(f.c_str());
+    }
+    files = std::move(merged);
+  }
+  return pass;
+}
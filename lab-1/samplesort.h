@@ -0,0 +1,504 @@
+#pragma once
+
+#include <algorithm> // std::move, std::swap_ranges, std::min, std::max
+#include <bit>       // std::bit_width
+#include <cstddef>   // std::size_t, std::ptrdiff_t
+#include <cstdint>   // std::uint64_t
+#include <iterator>  // std::random_access_iterator, std::iter_value_t
+#include <memory>    // std::unique_ptr
+#include <mutex>     // std::mutex, std::lock_guard
+#include <thread>    // std::this_thread::yield
+#include <utility>   // std::swap
+#include <vector>    // std::vector
+
+#include "scheduler.h" // Scheduler, TaskGroup
+#include "sorts.h"     // merge_sort
+
+namespace detail {
+
+/// Части не длиннее сортируются вставкой
+inline constexpr std::size_t samplesort_base{32};
+/// Наибольший log2 числа корзин
+inline constexpr unsigned samplesort_log_buckets{8};
+/// Размер блока перераспределения в байтах
+inline constexpr std::size_t samplesort_block_bytes{2048};
+/// Наименьшая часть массива на один поток разбиения
+inline constexpr std::size_t samplesort_stripe{1 << 14};
+
+/// Сортировка вставкой перемещениями (базовый случай)
+template <class It, class Compare>
+void samplesort_insertion(It first, It last, Compare comp) {
+  for (It i = first + 1; i < last; ++i) {
+    auto t = std::move(*i);
+    It j = i;
+    for (; j != first && comp(t, *(j - 1)); --j)
+      *j = std::move(*(j - 1));
+    *j = std::move(t);
+  }
+}
+
+/**
+ * @brief log2 числа корзин для части длины n
+ *
+ * Как в IPS4o: до 4096 элементов - один уровень с корзинами примерно по
+ * samplesort_base элементов, до 2^24 - два уровня поровну, дальше - 256
+ * корзин.
+ */
+inline unsigned samplesort_log_k(std::size_t n) {
+  const unsigned l =
+      static_cast<unsigned>(std::bit_width(n / samplesort_base)) - 1;
+  unsigned levels = samplesort_log_buckets;
+  if (n <= (std::size_t{1} << 12))
+    levels = l;
+  else if (n <= (std::size_t{1} << 24))
+    levels = (l + 1) / 2;
+  return std::clamp(levels, 1u, samplesort_log_buckets);
+}
+
+/**
+ * @brief Один шаг разбиения IPS4o: [first, first + n) раскладывается по
+ * корзинам на месте
+ *
+ * 1. Выборка: случайные элементы переставляются в начало и
+ *    сортируются, из них берутся k - 1 разделителей. Они хранятся
+ *    неявным двоичным деревом поиска (корень 1, потомки 2i и 2i + 1),
+ *    и корзина элемента - спуск i = 2i + comp(tree[i], x) без ветвлений
+ *    по результату сравнения. Спуски восьми элементов чередуются, чтобы
+ *    сравнения шли конвейером. Если разделители повторяются (много
+ *    одинаковых ключей), равные разделителю элементы уходят в отдельные
+ *    корзины равенства, которые дальше не сортируются.
+ * 2. Классификация: каждый поток проходит свою полосу массива и копит
+ *    элементы в буферах корзин по B элементов; полный буфер
+ *    записывается блоком в уже прочитанное начало полосы. Затем полные
+ *    блоки всех полос сдвигаются в начало массива.
+ * 3. Перестановка блоков: по счётчикам известны границы корзин, и
+ *    блок, лежащий не в своей корзине, меняется местами с блоком по
+ *    указателю записи корзины назначения, пока не попадёт на свободное
+ *    место. Указатели записи и чтения корзин - под мьютексами корзин,
+ *    так что блоки переставляют все потоки сразу.
+ * 4. Доводка: границы корзин не кратны B, поэтому хвост последнего
+ *    блока корзины, залезший в соседнюю, переносится в её начало, а
+ *    остатки буферов дописываются в промежутки.
+ *
+ * Дополнительная память - O(k * B) на поток и не зависит от n.
+ */
+template <class It, class Compare> class SampleSortStep {
+public:
+  using T = std::iter_value_t<It>;
+
+  /**
+   * @param first начало части
+   * @param n длина части (больше samplesort_base)
+   * @param comp функция сравнения
+   * @param threads число потоков разбиения
+   */
+  SampleSortStep(It first, std::size_t n, Compare comp, std::size_t threads)
+      : first(first), n(n), comp(comp), threads(threads) {}
+
+  /**
+   * @brief Разбить часть
+   * @param sched планировщик (nullptr - в текущем потоке)
+   */
+  void run(Scheduler *sched) {
+    choose_splitters();
+    block = std::clamp<std::size_t>(n / (4 * buckets), 1, block_max);
+    locals.resize(threads);
+    for (auto &local : locals) {
+      local.buffer.resize(buckets * block);
+      local.fill.assign(buckets, 0);
+      local.blocks.assign(buckets, 0);
+    }
+    const std::size_t per = (n + threads - 1) / threads;
+    const std::size_t stripe = (per + block - 1) / block * block;
+    each_thread(sched, [&](std::size_t t) {
+      classify_stripe(t, std::min(n, t * stripe),
+                      t + 1 == threads ? n : std::min(n, (t + 1) * stripe));
+    });
+    compute_bounds(stripe);
+    each_thread(sched, [&](std::size_t t) { permute(t); });
+    fix_overflow();
+    each_thread(sched, [&](std::size_t t) {
+      for (std::size_t b = t; b < buckets; b += threads)
+        fill_gaps(b);
+    });
+  }
+
+  /// Границы корзин: корзина b - [bounds[b], bounds[b + 1])
+  std::vector<std::size_t> bounds;
+  /// Число корзин
+  std::size_t buckets{0};
+  /// Нечётные корзины - корзины равенства (не сортируются дальше)
+  bool equal_buckets{false};
+
+private:
+  /// Указатели перестановки блоков корзины
+  struct BucketPointers {
+    std::mutex mutex;
+    std::ptrdiff_t write{0}; ///< Следующий блок для записи
+    std::ptrdiff_t read{0};  ///< Последний непрочитанный блок
+    int reading{0};          ///< Потоков, читающих блок корзины
+  };
+
+  /// Буферы потока
+  struct Local {
+    std::vector<T> buffer;           ///< Буферы корзин по block элементов
+    std::vector<std::size_t> fill;   ///< Заполнение буферов
+    std::vector<std::size_t> blocks; ///< Записано полных блоков корзины
+    std::size_t written{0};          ///< Записано элементов в полосу
+    std::vector<T> swap[2];          ///< Буферы перестановки блоков
+  };
+
+  static constexpr std::size_t block_max =
+      std::max<std::size_t>(1, samplesort_block_bytes / sizeof(T));
+
+  It first;
+  std::size_t n;
+  Compare comp;
+  std::size_t threads;
+  std::size_t block{1};
+
+  unsigned log_k{1};
+  std::size_t k{2};
+  std::vector<T> tree;     ///< Разделители в порядке обхода дерева
+  std::vector<T> splitter; ///< Разделители по возрастанию
+
+  std::vector<Local> locals;
+  std::vector<std::size_t> full; ///< Полных блоков корзины
+  std::vector<std::size_t> head; ///< Первый блок корзины
+  std::unique_ptr<BucketPointers[]> pointers;
+  std::vector<T> overflow; ///< Блок, выходящий за конец массива
+
+  /// Вызвать f(t) для каждого потока разбиения
+  template <class F> void each_thread(Scheduler *sched, const F &f) {
+    if (sched == nullptr || threads == 1) {
+      for (std::size_t t{0}; t < threads; ++t)
+        f(t);
+      return;
+    }
+    TaskGroup group(*sched);
+    for (std::size_t t{1}; t < threads; ++t)
+      group.run([&f, t] { f(t); });
+    f(0);
+    group.wait();
+  }
+
+  /// Заполнить поддерево node разделителями splitter[lo, hi)
+  void build_tree(std::size_t node, std::size_t lo, std::size_t hi) {
+    const std::size_t mid = lo + (hi - lo) / 2;
+    tree[node] = splitter[mid];
+    if (2 * node < k) {
+      build_tree(2 * node, lo, mid);
+      build_tree(2 * node + 1, mid + 1, hi);
+    }
+  }
+
+  /// Выборка и дерево разделителей
+  void choose_splitters() {
+    log_k = samplesort_log_k(n);
+    k = std::size_t{1} << log_k;
+    const std::size_t oversampling = std::max<std::size_t>(
+        1, static_cast<std::size_t>(std::bit_width(n)) / 5);
+    const std::size_t samples = std::min(n, oversampling * k);
+
+    std::uint64_t state = 0x9E3779B97F4A7C15ull ^ n;
+    for (std::size_t i{0}; i < samples; ++i) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      std::swap(first[i], first[i + state % (n - i)]);
+    }
+    merge_sort(first, first + samples, comp);
+
+    for (std::size_t i{1}; i < k; ++i) {
+      const T &s = first[i * samples / k];
+      if (splitter.empty() || comp(splitter.back(), s))
+        splitter.push_back(s);
+    }
+    // Повтор разделителя - признак крупных групп равных ключей. Один
+    // разделитель без корзины равенства не гарантирует уменьшения части.
+    equal_buckets = splitter.size() < k - 1 || splitter.size() == 1;
+    log_k = static_cast<unsigned>(std::bit_width(splitter.size()));
+    k = std::size_t{1} << log_k;
+    splitter.resize(k - 1, splitter.back());
+    tree.resize(k);
+    build_tree(1, 0, k - 1);
+    buckets = equal_buckets ? 2 * k : k;
+  }
+
+  /// Корзина по листу дерева b
+  std::size_t bucket_of(std::size_t b, const T &x) const {
+    if (!equal_buckets)
+      return b;
+    return 2 * b + (b + 1 < k && !comp(x, splitter[b]));
+  }
+
+  /// Корзина элемента x
+  std::size_t classify(const T &x) const {
+    std::size_t i{1};
+    for (unsigned l{0}; l < log_k; ++l)
+      i = 2 * i + comp(tree[i], x);
+    return bucket_of(i - k, x);
+  }
+
+  /// Корзины count элементов с from, спуски чередуются
+  template <std::size_t count> void classify_batch(It from, std::size_t *out) {
+    std::size_t i[count];
+    for (std::size_t j{0}; j < count; ++j)
+      i[j] = 1;
+    for (unsigned l{0}; l < log_k; ++l) {
+      for (std::size_t j{0}; j < count; ++j)
+        i[j] = 2 * i[j] + comp(tree[i[j]], from[j]);
+    }
+    for (std::size_t j{0}; j < count; ++j)
+      out[j] = bucket_of(i[j] - k, from[j]);
+  }
+
+  /// Положить элемент pos полосы в буфер корзины b
+  void distribute(Local &local, std::size_t begin, std::size_t pos,
+                  std::size_t b) {
+    T *buffer = local.buffer.data() + b * block;
+    buffer[local.fill[b]++] = std::move(first[pos]);
+    if (local.fill[b] == block) {
+      std::move(buffer, buffer + block, first + begin + local.written);
+      local.written += block;
+      local.fill[b] = 0;
+      ++local.blocks[b];
+    }
+  }
+
+  /// Классификация полосы [begin, end) потоком t
+  void classify_stripe(std::size_t t, std::size_t begin, std::size_t end) {
+    constexpr std::size_t batch{8};
+    Local &local = locals[t];
+    std::size_t b[batch];
+    std::size_t pos = begin;
+    for (; pos + batch <= end; pos += batch) {
+      classify_batch<batch>(first + pos, b);
+      for (std::size_t j{0}; j < batch; ++j)
+        distribute(local, begin, pos + j, b[j]);
+    }
+    for (; pos < end; ++pos)
+      distribute(local, begin, pos, classify(first[pos]));
+  }
+
+  /// Границы корзин и сдвиг полных блоков в начало массива
+  void compute_bounds(std::size_t stripe) {
+    full.assign(buckets, 0);
+    bounds.assign(buckets + 1, 0);
+    for (std::size_t b{0}; b < buckets; ++b) {
+      std::size_t count{0};
+      for (const auto &local : locals) {
+        full[b] += local.blocks[b];
+        count += local.blocks[b] * block + local.fill[b];
+      }
+      bounds[b + 1] = bounds[b] + count;
+    }
+
+    // Полосы после классификации: полные блоки в начале, затем пусто
+    std::size_t filled{0};
+    for (std::size_t t{0}; t < threads; ++t) {
+      const std::size_t begin = std::min(n, t * stripe);
+      if (begin != filled)
+        std::move(first + begin, first + begin + locals[t].written,
+                  first + filled);
+      filled += locals[t].written;
+    }
+
+    const auto filled_blocks = static_cast<std::ptrdiff_t>(filled / block);
+    head.assign(buckets + 1, 0);
+    for (std::size_t b{0}; b <= buckets; ++b)
+      head[b] = (bounds[b] + block - 1) / block;
+    pointers = std::make_unique<BucketPointers[]>(buckets);
+    for (std::size_t b{0}; b < buckets; ++b) {
+      pointers[b].write = static_cast<std::ptrdiff_t>(head[b]);
+      pointers[b].read = std::min(static_cast<std::ptrdiff_t>(head[b + 1]),
+                                  filled_blocks) -
+                         1;
+    }
+  }
+
+  /// Начало блока p
+  T *block_at(std::ptrdiff_t p) { return &first[p * block]; }
+
+  /// Перестановка блоков потоком t, начиная со своей доли корзин
+  void permute(std::size_t t) {
+    Local &local = locals[t];
+    local.swap[0].resize(block);
+    local.swap[1].resize(block);
+    T *carry = local.swap[0].data();
+    const std::size_t primary = t * buckets / threads;
+    for (std::size_t step{0}; step < buckets; ++step) {
+      BucketPointers &source = pointers[(primary + step) % buckets];
+      for (;;) {
+        std::ptrdiff_t p;
+        {
+          std::lock_guard lock(source.mutex);
+          if (source.read < source.write)
+            break;
+          p = source.read--;
+          ++source.reading;
+        }
+        std::move(block_at(p), block_at(p) + block, carry);
+        {
+          std::lock_guard lock(source.mutex);
+          --source.reading;
+        }
+        place(carry);
+      }
+    }
+  }
+
+  /// Довести блок carry до свободного места в его корзине
+  void place(T *carry) {
+    for (;;) {
+      BucketPointers &dest = pointers[classify(carry[0])];
+      std::ptrdiff_t q;
+      bool occupied;
+      {
+        std::lock_guard lock(dest.mutex);
+        q = dest.write++;
+        occupied = q <= dest.read;
+      }
+      if (occupied) {
+        std::swap_ranges(carry, carry + block, block_at(q));
+        continue;
+      }
+      // Свободное место могло быть только что прочитано другим потоком
+      for (;;) {
+        {
+          std::lock_guard lock(dest.mutex);
+          if (dest.reading == 0)
+            break;
+        }
+        std::this_thread::yield();
+      }
+      if (static_cast<std::size_t>(q + 1) * block > n) {
+        overflow.assign(std::make_move_iterator(carry),
+                        std::make_move_iterator(carry + block));
+      } else {
+        std::move(carry, carry + block, block_at(q));
+      }
+      return;
+    }
+  }
+
+  /// Элемент позиции pos; за концом массива - из overflow
+  T &element(std::size_t pos) {
+    return pos < n ? first[pos] : overflow[pos - n / block * block];
+  }
+
+  /// Перенести хвосты блоков, залезшие в следующую корзину
+  void fix_overflow() {
+    if (!overflow.empty()) {
+      const std::size_t tail = n / block * block;
+      std::move(overflow.begin(), overflow.begin() + (n - tail), first + tail);
+    }
+    for (std::size_t b{0}; b < buckets; ++b) {
+      const std::size_t end = head[b] * block + full[b] * block;
+      if (full[b] == 0 || end <= bounds[b + 1])
+        continue;
+      for (std::size_t i{0}; i < end - bounds[b + 1]; ++i)
+        first[bounds[b] + i] = std::move(element(bounds[b + 1] + i));
+    }
+  }
+
+  /// Дописать остатки буферов корзины b в её промежутки
+  void fill_gaps(std::size_t b) {
+    const std::size_t begin = head[b] * block;
+    const std::size_t end = begin + full[b] * block;
+    std::size_t pos = bounds[b];
+    if (full[b] > 0 && end > bounds[b + 1])
+      pos += end - bounds[b + 1];
+    for (auto &local : locals) {
+      T *buffer = local.buffer.data() + b * block;
+      for (std::size_t i{0}; i < local.fill[b]; ++i) {
+        if (full[b] > 0 && pos == begin)
+          pos = end;
+        first[pos++] = std::move(buffer[i]);
+      }
+    }
+  }
+};
+
+/// Рекурсия samplesort: разбиение, затем корзины
+template <class It, class Compare>
+void samplesort(Scheduler *sched, It first, It last, Compare comp) {
+  const auto n = static_cast<std::size_t>(last - first);
+  if (n <= samplesort_base) {
+    if (n > 1)
+      samplesort_insertion(first, last, comp);
+    return;
+  }
+  std::size_t threads{1};
+  if (sched != nullptr)
+    threads = std::clamp<std::size_t>(n / samplesort_stripe, 1, sched->size());
+  if (threads == 1)
+    sched = nullptr;
+
+  std::vector<std::size_t> bounds;
+  bool equal_buckets;
+  {
+    SampleSortStep<It, Compare> step(first, n, comp, threads);
+    step.run(sched);
+    bounds = std::move(step.bounds);
+    equal_buckets = step.equal_buckets;
+  }
+
+  auto sort_bucket = [&](std::size_t b, Scheduler *s) {
+    if (!(equal_buckets && b % 2 == 1))
+      samplesort(s, first + bounds[b], first + bounds[b + 1], comp);
+  };
+  if (sched == nullptr) {
+    for (std::size_t b{0}; b + 1 < bounds.size(); ++b)
+      sort_bucket(b, nullptr);
+    return;
+  }
+  // Крупные корзины снова разбиваются параллельно, мелкие - задачами
+  TaskGroup group(*sched);
+  for (std::size_t b{0}; b + 1 < bounds.size(); ++b) {
+    if (bounds[b + 1] - bounds[b] > samplesort_base)
+      group.run([&, b] { sort_bucket(b, sched); });
+  }
+  group.wait();
+  for (std::size_t b{0}; b + 1 < bounds.size(); ++b) {
+    if (bounds[b + 1] - bounds[b] <= samplesort_base)
+      sort_bucket(b, nullptr);
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Сортировка выборкой на месте (super scalar samplesort, IPS4o)
+ *
+ * Неустойчивая. Дополнительная память - буферы корзин O(k * B), а не n
+ * элементов, как у merge_sort(). См. detail::SampleSortStep.
+ *
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param comp функция сравнения
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void samplesort(RandomAccessIterator first, RandomAccessIterator last,
+                Compare comp) {
+  detail::samplesort(nullptr, first, last, comp);
+}
+
+/**
+ * @brief Параллельная сортировка выборкой на месте (IPS4o)
+ *
+ * Разбиение частей от 2 * detail::samplesort_stripe элементов выполняют
+ * несколько потоков планировщика (полосы классификации и общая
+ * перестановка блоков), корзины сортируются задачами. Памяти -
+ * O(k * B) на поток.
+ *
+ * @param sched планировщик
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param comp функция сравнения
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void parallel_samplesort(Scheduler &sched, RandomAccessIterator first,
+                         RandomAccessIterator last, Compare comp) {
+  sched.call([&] { detail::samplesort(&sched, first, last, comp); });
+}
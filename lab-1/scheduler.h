@@ -0,0 +1,484 @@
+#pragma once
+
+#include <algorithm>          // std::max
+#include <atomic>             // std::atomic, std::atomic_thread_fence
+#include <chrono>             // std::chrono::milliseconds
+#include <condition_variable> // std::condition_variable
+#include <cstdint>            // std::int64_t, std::uint64_t
+#include <deque>              // std::deque
+#include <exception>          // std::exception_ptr, std::rethrow_exception
+#include <functional>         // std::function
+#include <memory>             // std::unique_ptr
+#include <mutex>              // std::mutex, std::lock_guard
+#include <thread>             // std::thread, std::this_thread::yield
+#include <utility>            // std::forward
+#include <vector>             // std::vector
+
+#include <pthread.h> // pthread_setaffinity_np
+#include <sched.h>   // cpu_set_t, CPU_SET
+
+#include "metrics.h" // scheduler_queue_depth
+
+/**
+ * @brief Дек Чейза-Лева для планировщика с кражей работы
+ *
+ * Владелец кладёт и берёт элементы с нижнего конца (push/pop) без
+ * блокировок; другие потоки крадут с верхнего (steal) одним CAS.
+ * Массив растёт вдвое при переполнении; старые массивы не
+ * освобождаются до разрушения дека, так как вор может ещё читать их.
+ * Порядок памяти - по Lê, Pop, Cohen, Zappa Nardelli (PPoPP'13).
+ */
+template <class T> class WorkStealingDeque {
+public:
+  explicit WorkStealingDeque(std::int64_t capacity = 256) {
+    arrays.push_back(std::make_unique<Array>(capacity));
+    array.store(arrays.back().get(), std::memory_order_relaxed);
+  }
+
+  /// Положить элемент (только владелец)
+  void push(T x) {
+    const auto b = bottom.load(std::memory_order_relaxed);
+    const auto t = top.load(std::memory_order_acquire);
+    Array *a = array.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1)
+      a = grow(a, t, b);
+    a->put(b, x);
+    // Публикует задачу для steal() (вместо release-барьера в статье)
+    bottom.store(b + 1, std::memory_order_release);
+  }
+
+  /// Взять последний положенный элемент (только владелец) или T{}
+  T pop() {
+    const auto b = bottom.load(std::memory_order_relaxed) - 1;
+    Array *a = array.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return T{};
+    }
+    T x = a->get(b);
+    if (t == b) {
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+        x = T{};
+      }
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return x;
+  }
+
+  /// Украсть самый старый элемент (любой поток) или T{}
+  T steal() {
+    auto t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+      return T{};
+    Array *a = array.load(std::memory_order_acquire);
+    T x = a->get(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed)) {
+      return T{};
+    }
+    return x;
+  }
+
+  /// Приблизительное число элементов
+  std::int64_t size() const {
+    return bottom.load(std::memory_order_relaxed) -
+           top.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Array {
+    std::int64_t capacity;
+    std::unique_ptr<std::atomic<T>[]> slots;
+
+    explicit Array(std::int64_t capacity)
+        : capacity(capacity), slots(new std::atomic<T>[capacity]) {}
+
+    T get(std::int64_t i) const {
+      return slots[i & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+    void put(std::int64_t i, T x) {
+      slots[i & (capacity - 1)].store(x, std::memory_order_relaxed);
+    }
+  };
+
+  alignas(64) std::atomic<std::int64_t> top{0};
+  alignas(64) std::atomic<std::int64_t> bottom{0};
+  std::atomic<Array *> array{nullptr};
+  std::vector<std::unique_ptr<Array>> arrays;
+
+  Array *grow(Array *a, std::int64_t t, std::int64_t b) {
+    arrays.push_back(std::make_unique<Array>(a->capacity * 2));
+    Array *bigger = arrays.back().get();
+    for (auto i = t; i < b; ++i)
+      bigger->put(i, a->get(i));
+    array.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+};
+
+class TaskGroup;
+
+/// Задача планировщика
+struct Task {
+  std::function<void()> fn; ///< Что выполнить
+  TaskGroup *group;         ///< Группа, ожидающая завершения
+};
+
+/**
+ * @brief Планировщик задач с кражей работы
+ *
+ * У каждого рабочего потока свой WorkStealingDeque: порождённые им
+ * задачи кладутся туда же и выполняются в обратном порядке (глубина
+ * вперёд, данные в кэше), а простаивающие потоки крадут самые старые
+ * (крупные) задачи у случайной жертвы. Задачи из посторонних потоков
+ * попадают в общую очередь под мьютексом. Число поставленных, но ещё
+ * не начатых задач всех планировщиков выгружается метрикой
+ * lab1_scheduler_queue_depth (scheduler_queue_depth).
+ *
+ * Поток, ждущий группу (TaskGroup::wait), не блокируется, а выполняет
+ * чужие задачи, поэтому вложенный fork/join не исчерпывает потоки.
+ * Простаивающий поток сначала несколько раз уступает процессор, затем
+ * засыпает на условной переменной. spawn() при спящих потоках
+ * увеличивает под мьютексом счётчик пробуждений wake_epoch, и
+ * разбуженный поток видит новую работу в предикате ожидания - в том
+ * числе задачу, положенную в дек рабочего потока. Таймаут в
+ * миллисекунду остаётся только страховкой.
+ *
+ * Деструктор дожидается выполнения всех поставленных задач и
+ * останавливает потоки.
+ */
+class Scheduler {
+public:
+  /**
+   * @param threads число рабочих потоков
+   * @param pin привязать поток i к процессору i (по модулю числа
+   * процессоров)
+   */
+  explicit Scheduler(unsigned threads = std::thread::hardware_concurrency(),
+                     bool pin = false) {
+    threads = std::max(1u, threads);
+    for (unsigned i{0}; i < threads; ++i)
+      workers.push_back(std::make_unique<Worker>());
+    for (unsigned i{0}; i < threads; ++i) {
+      workers[i]->rng = 0x9e3779b97f4a7c15ULL * (i + 1);
+      workers[i]->thread = std::thread([this, i] { loop(i); });
+      if (pin) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(i % std::max(1u, std::thread::hardware_concurrency()), &set);
+        ::pthread_setaffinity_np(workers[i]->thread.native_handle(),
+                                 sizeof(set), &set);
+      }
+    }
+  }
+
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  ~Scheduler() {
+    {
+      std::lock_guard lock(mutex);
+      stopping.store(true, std::memory_order_release);
+    }
+    wake.notify_all();
+    for (auto &w : workers)
+      w->thread.join();
+  }
+
+  /// Число рабочих потоков
+  unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+  /// Выполняется ли вызывающий код в рабочем потоке этого планировщика
+  bool on_worker() const { return current == this; }
+
+  /**
+   * @brief Выполнить f в рабочем потоке и дождаться завершения
+   *
+   * Внешний поток, ожидая, не выполняет задачи сам: иначе он брал бы из
+   * общей очереди крупные задачи верхних уровней и рекурсия на его стеке
+   * росла бы без ограничения. Поэтому корень параллельного алгоритма
+   * запускается в рабочем потоке. Из рабочего потока f вызывается сразу.
+   */
+  template <class F> void call(F &&f);
+
+  /// Поставить задачу (из рабочего потока - в его дек)
+  void spawn(Task *task) {
+    scheduler_queue_depth.add(1);
+    if (current == this) {
+      workers[current_index]->deque.push(task);
+    } else {
+      std::lock_guard lock(mutex);
+      injected.push_back(task);
+      injected_count.fetch_add(1, std::memory_order_release);
+    }
+    // Задача опубликована до чтения sleeping; парный барьер - в loop()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed) > 0) {
+      {
+        std::lock_guard lock(mutex);
+        ++wake_epoch;
+      }
+      wake.notify_one();
+    }
+  }
+
+  /**
+   * @brief Выполнить одну задачу, если она найдётся
+   * @return false, если задач нет
+   */
+  bool run_one() {
+    const int self = current == this ? current_index : -1;
+    Task *task = self >= 0 ? workers[self]->deque.pop() : nullptr;
+    if (!task)
+      task = take_injected();
+    if (!task)
+      task = steal(self);
+    if (!task)
+      return false;
+    execute(task);
+    return true;
+  }
+
+private:
+  struct Worker {
+    WorkStealingDeque<Task *> deque;
+    std::thread thread;
+    std::uint64_t rng{0};
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Task *> injected;
+  std::atomic<std::size_t> injected_count{0};
+  std::atomic<int> sleeping{0};
+  std::uint64_t wake_epoch{0}; ///< Число пробуждений из spawn() (под mutex)
+  std::atomic<bool> stopping{false};
+
+  static inline thread_local Scheduler *current = nullptr;
+  static inline thread_local int current_index = -1;
+
+  inline void execute(Task *task);
+
+  Task *take_injected() {
+    if (injected_count.load(std::memory_order_acquire) == 0)
+      return nullptr;
+    std::lock_guard lock(mutex);
+    if (injected.empty())
+      return nullptr;
+    Task *task = injected.front();
+    injected.pop_front();
+    injected_count.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+  }
+
+  Task *steal(int self) {
+    thread_local std::uint64_t outside_rng = 0x2545f4914f6cdd1dULL;
+    std::uint64_t &rng = self >= 0 ? workers[self]->rng : outside_rng;
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    const std::size_t n = workers.size();
+    for (std::size_t k{0}; k < n; ++k) {
+      const std::size_t victim = (rng + k) % n;
+      if (static_cast<int>(victim) == self)
+        continue;
+      if (Task *task = workers[victim]->deque.steal())
+        return task;
+    }
+    return nullptr;
+  }
+
+  /// Есть ли задачи в общей очереди или деках (вызывается под mutex)
+  bool has_work() const {
+    if (!injected.empty())
+      return true;
+    for (const auto &w : workers) {
+      if (w->deque.size() > 0)
+        return true;
+    }
+    return false;
+  }
+
+  void loop(unsigned i) {
+    current = this;
+    current_index = static_cast<int>(i);
+    int idle{0};
+    for (;;) {
+      if (run_one()) {
+        idle = 0;
+        continue;
+      }
+      if (stopping.load(std::memory_order_acquire))
+        break;
+      if (++idle < 64) {
+        std::this_thread::yield();
+        continue;
+      }
+      std::unique_lock lock(mutex);
+      const std::uint64_t seen = wake_epoch;
+      sleeping.fetch_add(1, std::memory_order_seq_cst);
+      // Задачу, положенную до увеличения sleeping, видит has_work(),
+      // положенную после - spawn() отмечает в wake_epoch
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      wake.wait_for(lock, std::chrono::milliseconds(1), [&] {
+        return stopping.load(std::memory_order_relaxed) ||
+               wake_epoch != seen || has_work();
+      });
+      sleeping.fetch_sub(1, std::memory_order_acq_rel);
+    }
+  }
+};
+
+/**
+ * @brief Группа задач с ожиданием завершения (fork/join)
+ *
+ * run() порождает задачу, wait() помогает выполнять задачи, пока все
+ * задачи группы не завершатся, и пробрасывает первое исключение из них.
+ * Деструктор тоже ждёт.
+ */
+class TaskGroup {
+public:
+  explicit TaskGroup(Scheduler &sched) : sched(sched) {}
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  ~TaskGroup() {
+    while (pending.load(std::memory_order_acquire) != 0)
+      help();
+  }
+
+  /// Породить задачу
+  template <class F> void run(F &&f) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    sched.spawn(new Task{std::forward<F>(f), this});
+  }
+
+  /**
+   * @brief Дождаться всех задач группы
+   *
+   * Рабочий поток тем временем выполняет другие задачи, внешний -
+   * просто ждёт (см. Scheduler::call).
+   */
+  void wait() {
+    while (pending.load(std::memory_order_acquire) != 0)
+      help();
+    if (error) {
+      auto e = error;
+      error = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+private:
+  friend class Scheduler;
+  Scheduler &sched;
+  std::atomic<std::size_t> pending{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  void help() {
+    if (!sched.on_worker() || !sched.run_one())
+      std::this_thread::yield();
+  }
+
+  void finish(std::exception_ptr e) {
+    if (e) {
+      std::lock_guard lock(error_mutex);
+      if (!error)
+        error = e;
+    }
+    pending.fetch_sub(1, std::memory_order_release);
+  }
+};
+
+inline void Scheduler::execute(Task *task) {
+  scheduler_queue_depth.add(-1);
+  std::exception_ptr e;
+  try {
+    task->fn();
+  } catch (...) {
+    e = std::current_exception();
+  }
+  TaskGroup *group = task->group;
+  delete task;
+  group->finish(e);
+}
+
+template <class F> void Scheduler::call(F &&f) {
+  if (on_worker()) {
+    f();
+    return;
+  }
+  TaskGroup group(*this);
+  group.run([&f] { f(); });
+  group.wait();
+}
+
+/**
+ * @brief Выполнить f и g параллельно
+ *
+ * g порождается как задача, f выполняется в текущем потоке (вызов
+ * из внешнего потока переносится в рабочий, см. Scheduler::call).
+ */
+template <class F, class G>
+void parallel_invoke(Scheduler &sched, F &&f, G &&g) {
+  if (!sched.on_worker()) {
+    sched.call([&] { parallel_invoke(sched, f, g); });
+    return;
+  }
+  TaskGroup group(sched);
+  group.run([&g] { g(); });
+  f();
+  group.wait();
+}
+
+/**
+ * @brief Параллельный цикл по [begin, end)
+ *
+ * Диапазон делится пополам до частей не больше grain, каждая часть
+ * обрабатывается вызовом body(b, e).
+ */
+template <class Body>
+void parallel_for(Scheduler &sched, std::size_t begin, std::size_t end,
+                  std::size_t grain, const Body &body) {
+  if (end - begin <= std::max<std::size_t>(1, grain)) {
+    body(begin, end);
+    return;
+  }
+  const std::size_t mid = begin + (end - begin) / 2;
+  parallel_invoke(
+      sched, [&] { parallel_for(sched, begin, mid, grain, body); },
+      [&] { parallel_for(sched, mid, end, grain, body); });
+}
+
+/**
+ * @brief Параллельная свёртка по [begin, end)
+ *
+ * Части не больше grain сворачиваются вызовом map(b, e), результаты
+ * соседних частей объединяются combine(левый, правый).
+ */
+template <class T, class Map, class Combine>
+T parallel_reduce(Scheduler &sched, std::size_t begin, std::size_t end,
+                  std::size_t grain, const Map &map, const Combine &combine) {
+  if (end - begin <= std::max<std::size_t>(1, grain))
+    return map(begin, end);
+  const std::size_t mid = begin + (end - begin) / 2;
+  T left{}, right{};
+  parallel_invoke(
+      sched,
+      [&] {
+        left = parallel_reduce<T>(sched, begin, mid, grain, map, combine);
+      },
+      [&] {
+        right = parallel_reduce<T>(sched, mid, end, grain, map, combine);
+      });
+  return combine(left, right);
+}
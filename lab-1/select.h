@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm> // std::iter_swap, std::max, std::min, std::sort
+#include <cmath>     // std::log, std::exp, std::sqrt
+#include <cstdint>   // std::uint32_t
+#include <iterator>  // std::random_access_iterator (concept)
+#include <vector>    // std::vector
+
+#include "sorts.h" // merge_sort
+
+/**
+ * @brief Выбор k-й порядковой статистики (алгоритм Флойда-Ривеста)
+ *
+ * После вызова на позиции first + k стоит элемент, который стоял бы там
+ * после сортировки, слева от него - не большие, справа - не меньшие.
+ * На больших диапазонах опорный элемент уточняется рекурсивным выбором
+ * по выборке, поэтому ожидаемое число сравнений n + min(k, n - k) + o(n).
+ * Если число итераций превышает 2 log2 n (неудачные данные), оставшийся
+ * диапазон досортировывается merge_sort(), что ограничивает худший
+ * случай O(n log n).
+ *
+ * @param first итератор на начало контейнера
+ * @param k номер искомого элемента (с нуля)
+ * @param last итератор на конец контейнера
+ * @param comp функция сравнения
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void select_nth(RandomAccessIterator first, long k, RandomAccessIterator last,
+                Compare comp) {
+  long left{0}, right = static_cast<long>(last - first) - 1;
+  if (k < 0 || k > right) {
+    return;
+  }
+
+  int budget{2};
+  for (long n = right + 1; n > 1; n /= 2) {
+    budget += 2;
+  }
+
+  while (right > left) {
+    if (--budget < 0) {
+      merge_sort(first + left, first + right + 1, comp);
+      return;
+    }
+
+    if (right - left > 600) {
+      const double n = right - left + 1;
+      const double i = k - left + 1;
+      const double z = std::log(n);
+      const double s = 0.5 * std::exp(2 * z / 3);
+      const double sd =
+          0.5 * std::sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1 : 1);
+      const long new_left =
+          std::max(left, static_cast<long>(k - i * s / n + sd));
+      const long new_right =
+          std::min(right, static_cast<long>(k + (n - i) * s / n + sd));
+      select_nth(first + new_left, k - new_left, first + new_right + 1, comp);
+    }
+
+    const auto t = *(first + k);
+    long i = left, j = right;
+    std::iter_swap(first + left, first + k);
+    if (comp(t, *(first + right))) {
+      std::iter_swap(first + right, first + left);
+    }
+    while (i < j) {
+      std::iter_swap(first + i, first + j);
+      ++i;
+      --j;
+      while (comp(*(first + i), t))
+        ++i;
+      while (comp(t, *(first + j)))
+        --j;
+    }
+    if (!comp(*(first + left), t) && !comp(t, *(first + left))) {
+      std::iter_swap(first + left, first + j);
+    } else {
+      ++j;
+      std::iter_swap(first + j, first + right);
+    }
+    if (j <= k)
+      left = j + 1;
+    if (k <= j)
+      right = j - 1;
+  }
+}
+
+/**
+ * @brief Выбрать сразу несколько порядковых статистик
+ *
+ * Сначала выбирается средний из запрошенных номеров, затем левая и
+ * правая части обрабатываются независимо только со своими номерами,
+ * так что каждый следующий выбор идёт по всё меньшему диапазону.
+ *
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param ks_first указатель на начало номеров элементов (с нуля),
+ * упорядоченных по возрастанию
+ * @param ks_last указатель на конец номеров элементов
+ * @param comp функция сравнения
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void multi_select(RandomAccessIterator first, RandomAccessIterator last,
+                  const long *ks_first, const long *ks_last, Compare comp) {
+  if (ks_first == ks_last || last - first < 2) {
+    return;
+  }
+  const long *mid = ks_first + (ks_last - ks_first) / 2;
+  select_nth(first, *mid, last, comp);
+
+  const long *lo = mid, *hi = mid + 1;
+  while (lo != ks_first && *(lo - 1) == *mid)
+    --lo;
+  while (hi != ks_last && *hi == *mid)
+    ++hi;
+
+  multi_select(first, first + *mid, ks_first, lo, comp);
+
+  std::vector<long> right(hi, ks_last);
+  for (auto &k : right) {
+    k -= *mid + 1;
+  }
+  multi_select(first + *mid + 1, last, right.data(),
+               right.data() + right.size(), comp);
+}
+
+/**
+ * @brief Номер элемента для квантиля q (метод "ближайший ранг")
+ * @param n число элементов
+ * @param q уровень квантиля в [0, 1]
+ */
+inline long quantile_rank(std::size_t n, double q) {
+  if (n == 0)
+    return 0;
+  const long k = static_cast<long>(std::ceil(q * n)) - 1;
+  return std::clamp(k, 0l, static_cast<long>(n) - 1);
+}
+
+/**
+ * @brief Квантили значений без полной сортировки
+ * @param values значения (переупорядочиваются)
+ * @param qs уровни квантилей в [0, 1]
+ * @return Значения квантилей в порядке qs (пусто, если values пуст)
+ */
+template <class T>
+std::vector<T> quantiles(std::vector<T> &values,
+                         const std::vector<double> &qs) {
+  std::vector<T> out;
+  if (values.empty()) {
+    return out;
+  }
+  std::vector<long> ks;
+  for (double q : qs) {
+    ks.push_back(quantile_rank(values.size(), q));
+  }
+  std::vector<long> sorted_ks = ks;
+  std::sort(sorted_ks.begin(), sorted_ks.end());
+  multi_select(values.begin(), values.end(), sorted_ks.data(),
+               sorted_ks.data() + sorted_ks.size(), std::less<T>());
+  for (long k : ks) {
+    out.push_back(values[k]);
+  }
+  return out;
+}
+
+/**
+ * @brief Квантили по группам
+ *
+ * Значения раскладываются по группам одним проходом (подсчётом), затем
+ * для каждой группы вызывается quantiles().
+ *
+ * @param groups номер группы для каждой строки (например, код подразделения)
+ * @param values значение для каждой строки (например, зарплата)
+ * @param group_count число групп
+ * @param qs уровни квантилей в [0, 1]
+ * @return Для каждой группы - значения квантилей в порядке qs
+ */
+template <class T>
+std::vector<std::vector<T>>
+group_quantiles(const std::vector<std::uint32_t> &groups,
+                const std::vector<T> &values, std::size_t group_count,
+                const std::vector<double> &qs) {
+  std::vector<std::size_t> start(group_count + 1, 0);
+  for (auto g : groups) {
+    ++start[g + 1];
+  }
+  for (std::size_t g{0}; g < group_count; ++g) {
+    start[g + 1] += start[g];
+  }
+
+  std::vector<T> bucketed(values.size());
+  auto pos = start;
+  for (std::size_t i{0}; i < values.size(); ++i) {
+    bucketed[pos[groups[i]]++] = values[i];
+  }
+
+  std::vector<std::vector<T>> out;
+  for (std::size_t g{0}; g < group_count; ++g) {
+    std::vector<T> part(bucketed.begin() + start[g],
+                        bucketed.begin() + start[g + 1]);
+    out.push_back(quantiles(part, qs));
+  }
+  return out;
+}
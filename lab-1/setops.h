@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm> // std::max
+#include <cstdio>    // std::remove
+#include <fstream>   // std::ofstream
+#include <iostream>  // std::cerr
+#include <string>    // std::string
+#include <tuple>     // std::tie
+#include <vector>    // std::vector
+
+#include "runs.h"    // make_runs, reduce_runs, merge_runs
+#include "soldier.h" // Soldier, SoldierReader, write_row
+
+/**
+ * @brief Полное сравнение строк датасета
+ *
+ * Порядок как у operator< (подразделение, ФИО), но должность учитывается
+ * до зарплаты - так упорядоченный файл упорядочен и по ключу KeyLess.
+ */
+struct RecordLess {
+  bool operator()(const Soldier &a, const Soldier &b) const {
+    return std::tie(a.unit, a.full_name, a.job, a.salary) <
+           std::tie(b.unit, b.full_name, b.job, b.salary);
+  }
+};
+
+/**
+ * @brief Сравнение строк по ключу (подразделение, ФИО, должность)
+ *
+ * Используется при сравнении двух выгрузок: строки с одинаковым ключом
+ * считаются одним и тем же военнослужащим.
+ */
+struct KeyLess {
+  bool operator()(const Soldier &a, const Soldier &b) const {
+    return std::tie(a.unit, a.full_name, a.job) <
+           std::tie(b.unit, b.full_name, b.job);
+  }
+};
+
+/**
+ * @brief Проверить, упорядочен ли файл, не загружая его целиком
+ * @param filename имя датасета
+ * @param comp функция сравнения
+ */
+template <class Compare>
+bool is_sorted_csv(const std::string &filename, Compare comp) {
+  SoldierReader reader(filename);
+  Soldier prev, cur;
+  if (!reader.next(prev)) {
+    return true;
+  }
+  while (reader.next(cur)) {
+    if (comp(cur, prev)) {
+      return false;
+    }
+    prev = std::move(cur);
+  }
+  return true;
+}
+
+/**
+ * @brief Получить упорядоченную по RecordLess версию датасета
+ *
+ * Если файл уже упорядочен, возвращается его имя и ничего не
+ * загружается. Иначе он сортируется внешне, как в budget_sort():
+ * отрезки выбором с замещением в половине memory_bytes (make_runs),
+ * затем слияние не более чем memory_bytes / 2 / run_reader_bytes
+ * отрезков за проход в tmp. Так память операции над множествами
+ * ограничена memory_bytes и буферами слияния при любых входах.
+ *
+ * @param filename имя датасета
+ * @param tmp имя временного файла для отсортированной копии (его
+ * отрезки - tmp + ".<номер>.run" - удаляются)
+ * @param memory_bytes ограничение памяти на сортировку
+ * @return Имя файла, который можно читать слиянием
+ */
+inline std::string sorted_input(const std::string &filename,
+                                const std::string &tmp,
+                                std::size_t memory_bytes = 64 << 20) {
+  if (is_sorted_csv(filename, RecordLess())) {
+    return filename;
+  }
+  const std::string prefix = tmp + ".";
+  std::vector<std::string> files =
+      make_runs(filename, prefix, memory_bytes / 2, RecordLess()).files;
+  const std::size_t fan_in =
+      std::max<std::size_t>(2, memory_bytes / 2 / run_reader_bytes);
+  reduce_runs(files, fan_in, prefix, RecordLess());
+
+  std::ofstream ofile(tmp);
+  if (!ofile.is_open()) {
+    std::cerr << "sorted_input: Couldn't open file\n";
+  }
+  merge_runs(
+      files, [&](const Soldier &s) { write_row(ofile, s); }, RecordLess());
+  for (const auto &f : files) {
+    std::remove(f.c_str());
+  }
+  return tmp;
+}
+
+/// Теоретико-множественная операция над двумя датасетами
+enum class SetOp { union_, intersection, difference };
+
+/**
+ * @brief Объединение, пересечение или разность двух упорядоченных датасетов
+ *
+ * Оба входа читаются одним проходом слиянием (как std::set_union и
+ * т.п., т.е. с семантикой мультимножеств), результат сразу пишется в файл.
+ *
+ * @param op операция
+ * @param a_file первый датасет (упорядочен по RecordLess)
+ * @param b_file второй датасет (упорядочен по RecordLess)
+ * @param out_file имя файла результата
+ * @return Число записанных строк
+ */
+inline std::size_t set_operation(SetOp op, const std::string &a_file,
+                                 const std::string &b_file,
+                                 const std::string &out_file) {
+  SoldierReader ra(a_file), rb(b_file);
+  std::ofstream ofile(out_file);
+  if (!ofile.is_open()) {
+    std::cerr << "set_operation: Couldn't open file\n";
+  }
+
+  RecordLess less;
+  std::size_t written{0};
+  auto emit = [&](const Soldier &s) {
+    write_row(ofile, s);
+    ++written;
+  };
+
+  Soldier x, y;
+  bool hx = ra.next(x), hy = rb.next(y);
+  while (hx && hy) {
+    if (less(x, y)) {
+      if (op != SetOp::intersection)
+        emit(x);
+      hx = ra.next(x);
+    } else if (less(y, x)) {
+      if (op == SetOp::union_)
+        emit(y);
+      hy = rb.next(y);
+    } else {
+      if (op != SetOp::difference)
+        emit(x);
+      hx = ra.next(x);
+      hy = rb.next(y);
+    }
+  }
+  for (; hx && op != SetOp::intersection; hx = ra.next(x)) {
+    emit(x);
+  }
+  for (; hy && op == SetOp::union_; hy = rb.next(y)) {
+    emit(y);
+  }
+  return written;
+}
+
+/// Итоги сравнения двух выгрузок
+struct DiffStats {
+  std::size_t added{0};   ///< Есть только в новой выгрузке
+  std::size_t removed{0}; ///< Есть только в старой выгрузке
+  std::size_t changed{0}; ///< Есть в обеих, но зарплата изменилась
+};
+
+/**
+ * @brief Сравнить две выгрузки по ключу KeyLess
+ *
+ * Строки результата: "+,<строка>" - принят, "-,<строка>" - уволен,
+ * "~,<новая строка>,<старая зарплата>" - изменилась зарплата.
+ * Входы читаются одним проходом слиянием.
+ *
+ * @param old_file старая выгрузка (упорядочена по RecordLess)
+ * @param new_file новая выгрузка (упорядочена по RecordLess)
+ * @param out_file имя файла результата
+ * @return Число добавленных, удалённых и изменённых строк
+ */
+inline DiffStats diff(const std::string &old_file, const std::string &new_file,
+                      const std::string &out_file) {
+  SoldierReader ra(old_file), rb(new_file);
+  std::ofstream ofile(out_file);
+  if (!ofile.is_open()) {
+    std::cerr << "diff: Couldn't open file\n";
+  }
+
+  KeyLess less;
+  DiffStats stats;
+  Soldier x, y;
+  bool hx = ra.next(x), hy = rb.next(y);
+  while (hx || hy) {
+    if (hx && (!hy || less(x, y))) {
+      ofile << "-,";
+      write_row(ofile, x);
+      ++stats.removed;
+      hx = ra.next(x);
+    } else if (hy && (!hx || less(y, x))) {
+      ofile << "+,";
+      write_row(ofile, y);
+      ++stats.added;
+      hy = rb.next(y);
+    } else {
+      if (x.salary != y.salary) {
+        ofile << "~," << y.full_name << ',' << y.job << ',' << y.unit << ','
+              << y.salary << ',' << x.salary << '\n';
+        ++stats.changed;
+      }
+      hx = ra.next(x);
+      hy = rb.next(y);
+    }
+  }
+  return stats;
+}
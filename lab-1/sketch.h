@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>     // std::sort
+#include <bit>           // std::countl_zero
+#include <cmath>         // std::log, std::pow, std::ceil
+#include <cstdint>       // std::uint8_t, std::uint64_t
+#include <fstream>       // std::ifstream
+#include <functional>    // std::hash
+#include <iostream>      // std::cerr
+#include <string>        // std::string, std::getline
+#include <thread>        // std::thread
+#include <unordered_map> // std::unordered_map
+#include <utility>       // std::pair
+#include <vector>        // std::vector
+
+#include "soldier.h" // Soldier, split
+
+/**
+ * @brief Перемешивание 64-битного хеша (финализатор splitmix64)
+ */
+inline std::uint64_t mix_hash(std::uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief Скетч KLL для приближённых квантилей
+ *
+ * Значения накапливаются в уровнях-компакторах; элемент уровня h
+ * представляет 2^h исходных значений. Переполненный уровень сортируется,
+ * и каждый второй элемент (со случайным сдвигом) переносится на уровень
+ * выше. Вместимость уровней убывает в 3/2 раза вниз от верхнего, так что
+ * память O(k log(n / k)), а ошибка ранга порядка 1.7 / k.
+ */
+class KllSketch {
+public:
+  /// @param k точность (вместимость верхнего уровня)
+  explicit KllSketch(unsigned k = 200) : k(k), levels(1) {}
+
+  /// Добавить значение
+  void update(double x) {
+    levels[0].push_back(x);
+    ++n;
+    if (++stored > max_size())
+      compress();
+  }
+
+  /// Объединить с другим скетчем (например, из другого потока)
+  void merge(const KllSketch &other) {
+    while (levels.size() < other.levels.size())
+      levels.emplace_back();
+    for (std::size_t h{0}; h < other.levels.size(); ++h) {
+      levels[h].insert(levels[h].end(), other.levels[h].begin(),
+                       other.levels[h].end());
+    }
+    n += other.n;
+    stored += other.stored;
+    while (stored > max_size())
+      compress();
+  }
+
+  /// Число учтённых значений
+  std::uint64_t count() const { return n; }
+
+  /**
+   * @brief Приближённый квантиль
+   * @param q уровень квантиля в [0, 1]
+   */
+  double quantile(double q) const {
+    std::vector<std::pair<double, std::uint64_t>> items;
+    for (std::size_t h{0}; h < levels.size(); ++h) {
+      for (double x : levels[h])
+        items.emplace_back(x, std::uint64_t{1} << h);
+    }
+    if (items.empty())
+      return 0;
+    std::sort(items.begin(), items.end());
+
+    std::uint64_t total{0};
+    for (const auto &it : items)
+      total += it.second;
+    const double target = q * total;
+    std::uint64_t seen{0};
+    for (const auto &[x, w] : items) {
+      seen += w;
+      if (seen >= target)
+        return x;
+    }
+    return items.back().first;
+  }
+
+  /// Занимаемая память в байтах (приблизительно)
+  std::size_t bytes() const {
+    std::size_t b = sizeof(*this);
+    for (const auto &l : levels)
+      b += l.capacity() * sizeof(double);
+    return b;
+  }
+
+private:
+  unsigned k;
+  std::uint64_t n{0};
+  std::size_t stored{0};
+  std::uint64_t coin{0x853c49e6748fea9bULL};
+  std::vector<std::vector<double>> levels;
+
+  std::size_t capacity(std::size_t h) const {
+    const double depth = static_cast<double>(levels.size() - h - 1);
+    return std::max<std::size_t>(
+        2, static_cast<std::size_t>(std::ceil(k * std::pow(2.0 / 3, depth))));
+  }
+
+  std::size_t max_size() const {
+    std::size_t s{0};
+    for (std::size_t h{0}; h < levels.size(); ++h)
+      s += capacity(h);
+    return s;
+  }
+
+  /// Сжать самый нижний переполненный уровень
+  void compress() {
+    for (std::size_t h{0}; h < levels.size(); ++h) {
+      if (levels[h].size() < capacity(h))
+        continue;
+      if (h + 1 == levels.size())
+        levels.emplace_back();
+
+      auto &level = levels[h];
+      std::sort(level.begin(), level.end());
+      coin = mix_hash(coin);
+      const std::size_t odd = level.size() % 2;
+      for (std::size_t i = coin & 1; i + odd < level.size(); i += 2) {
+        levels[h + 1].push_back(level[i]);
+      }
+      const std::size_t pairs = (level.size() - odd) / 2;
+      if (odd) {
+        level.front() = level.back();
+      }
+      level.resize(odd);
+      stored -= pairs;
+      return;
+    }
+  }
+};
+
+/**
+ * @brief Скетч HyperLogLog для числа различных значений
+ *
+ * 2^12 однобайтовых регистров (4 КБ), относительная ошибка около 1.6%.
+ */
+class HyperLogLog {
+public:
+  /// Учесть значение по его 64-битному хешу
+  void update(std::uint64_t hash) {
+    const std::size_t idx = hash >> (64 - p);
+    const std::uint64_t w = (hash << p) | (std::uint64_t{1} << (p - 1));
+    const auto rho = static_cast<std::uint8_t>(std::countl_zero(w) + 1);
+    if (rho > registers[idx])
+      registers[idx] = rho;
+  }
+
+  /// Учесть строку
+  void update(const std::string &s) {
+    update(mix_hash(std::hash<std::string>()(s)));
+  }
+
+  /// Объединить с другим скетчем
+  void merge(const HyperLogLog &other) {
+    for (std::size_t i{0}; i < m; ++i)
+      registers[i] = std::max(registers[i], other.registers[i]);
+  }
+
+  /// Оценка числа различных значений
+  double estimate() const {
+    double sum{0};
+    std::size_t zeros{0};
+    for (auto r : registers) {
+      sum += std::ldexp(1.0, -r);
+      zeros += r == 0;
+    }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros > 0)
+      return m * std::log(static_cast<double>(m) / zeros);
+    return e;
+  }
+
+private:
+  static constexpr unsigned p = 12;
+  static constexpr std::size_t m = std::size_t{1} << p;
+  std::vector<std::uint8_t> registers = std::vector<std::uint8_t>(m, 0);
+};
+
+/**
+ * @brief Сводка по датасету фиксированного размера
+ *
+ * Квантили зарплаты по подразделениям и число различных ФИО.
+ * Сводки разных частей файла объединяются через merge().
+ */
+struct SoldierSummary {
+  std::unordered_map<std::string, KllSketch> salary_by_unit; ///< По подразд.
+  HyperLogLog names;                                         ///< Различные ФИО
+  std::uint64_t rows{0};                                     ///< Число строк
+
+  /// Учесть строку датасета
+  void update(const Soldier &s) {
+    salary_by_unit[s.unit].update(s.salary);
+    names.update(s.full_name);
+    ++rows;
+  }
+
+  /// Объединить со сводкой другой части файла
+  void merge(const SoldierSummary &other) {
+    for (const auto &[unit, sketch] : other.salary_by_unit)
+      salary_by_unit[unit].merge(sketch);
+    names.merge(other.names);
+    rows += other.rows;
+  }
+};
+
+/**
+ * @brief Построить сводку по части файла
+ *
+ * Обрабатываются строки, начинающиеся в байтах [begin, end); строка,
+ * на середину которой попал begin, относится к предыдущей части.
+ *
+ * @param filename имя датасета
+ * @param begin начало части (в байтах)
+ * @param end конец части (в байтах)
+ */
+inline SoldierSummary summarize_range(const std::string &filename,
+                                      std::streamoff begin,
+                                      std::streamoff end) {
+  SoldierSummary summary;
+  std::ifstream ifile(filename, std::ios::binary);
+  if (!ifile.is_open()) {
+    std::cerr << "summarize_range: Couldn't open file\n";
+    return summary;
+  }
+
+  std::string line;
+  if (begin > 0) {
+    ifile.seekg(begin - 1);
+    std::getline(ifile, line);
+  }
+  while (ifile.tellg() < end && std::getline(ifile, line)) {
+    std::vector<std::string> fields_v = split(line, ',');
+    summary.update(
+        Soldier(fields_v[0], fields_v[1], fields_v[2], std::stoi(fields_v[3])));
+  }
+  return summary;
+}
+
+/**
+ * @brief Построить сводку по датасету за один проход без загрузки строк
+ *
+ * Файл делится на части по числу потоков, каждая часть сканируется
+ * своим потоком в свою сводку, затем сводки объединяются.
+ *
+ * @param filename имя датасета
+ * @param threads число потоков
+ */
+inline SoldierSummary summarize_csv(const std::string &filename,
+                                    unsigned threads) {
+  std::ifstream ifile(filename, std::ios::binary | std::ios::ate);
+  const std::streamoff size =
+      ifile.is_open() ? static_cast<std::streamoff>(ifile.tellg()) : 0;
+  threads = std::max(1u, threads);
+
+  std::vector<SoldierSummary> parts(threads);
+  std::vector<std::thread> workers;
+  for (unsigned t{0}; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      parts[t] = summarize_range(filename, size * t / threads,
+                                 size * (t + 1) / threads);
+    });
+  }
+  for (auto &w : workers)
+    w.join();
+
+  for (unsigned t{1}; t < threads; ++t)
+    parts[0].merge(parts[t]);
+  return parts[0];
+}
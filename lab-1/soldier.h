@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>  // std::min
+#include <filesystem> // std::filesystem::file_size
+#include <fstream>    // std::ifstream, std::ofstream
+#include <iostream>   // std::cerr
+#include <sstream>    // std::istringstream
+#include <string>     // std::string, std::getline
+#include <tuple>      // std::tie
+#include <vector>     // std::vector
+
+#include "metrics.h" // lab_metrics
+#include "trace.h"   // LAB1_PROBE1, LAB1_PROBE2
+
+/**
+ * @brief Строка из датасета
+ *
+ * Представляет собой структуру, содержащую информацию
+ * о военнослужащем (ФИО, должность, подразделение, зарплата)
+ */
+struct Soldier {
+  std::string full_name; ///< ФИО
+  std::string job;       ///< Должность
+  std::string unit;      ///< Подразделение
+  int salary;            ///< Зарплата
+
+  Soldier() = default;
+  Soldier(std::string f, std::string j, std::string u, int s)
+      : full_name(f), job(j), unit(u), salary(s) {}
+};
+
+/**
+ * @brief Перегрузка оператора "<" для сравнения объектов Soldier
+ *
+ * Сначала сравниваются подразделения, затем ФИО, затем зарплата.
+ */
+inline bool operator<(const Soldier &a, const Soldier &b) {
+  return std::tie(a.unit, a.full_name, a.salary) <
+         std::tie(b.unit, b.full_name, b.salary);
+}
+
+/**
+ * @brief Перегрузка оператора "<" для сравнения объектов @see Soldier
+ *
+ * Сначала сравниваются подразделения, затем ФИО, затем зарплата.
+ */
+inline bool operator>(const Soldier &a, const Soldier &b) {
+  return std::tie(a.unit, a.full_name, a.salary) >
+         std::tie(b.unit, b.full_name, b.salary);
+}
+
+/**
+ * @brief Перегрузка оператора ">" для сравнения объектов @see Soldier
+ *
+ * Сначала сравниваются подразделения, затем ФИО, затем зарплата.
+ */
+inline bool operator<=(const Soldier &a, const Soldier &b) {
+  return std::tie(a.unit, a.full_name, a.salary) <=
+         std::tie(b.unit, b.full_name, b.salary);
+}
+
+/**
+ * @brief Перегрузка оператора ">=" для сравнения объектов @see Soldier
+ *
+ * Сначала сравниваются подразделения, затем ФИО, затем зарплата.
+ */
+inline bool operator>=(const Soldier &a, const Soldier &b) {
+  return std::tie(a.unit, a.full_name, a.salary) >=
+         std::tie(b.unit, b.full_name, b.salary);
+}
+
+/**
+ * @brief Разделить строку по разделителю
+ *
+ * Функция позволяет разделить переданную строку (std::string)
+ * по разделителю (по умолчанию - пробел). Используется для
+ * считывания датасетов (.csv файл)
+ *
+ * @param str строка, которую нужно разделить
+ * @param del разделитель
+ * @return Разделенную строку, представленную в виде вектора строк
+ */
+inline std::vector<std::string> split(const std::string &str,
+                                      char del = ' ') {
+  std::vector<std::string> out;
+  std::istringstream is(str);
+  std::string t;
+  while (std::getline(is, t, del)) {
+    out.push_back(t);
+  }
+  return out;
+}
+
+/// Оценка размеров датасета по началу файла
+struct DatasetEstimate {
+  std::size_t file_bytes{0}; ///< Размер файла
+  std::size_t rows{0};       ///< Число строк
+  std::size_t name_bytes{0}; ///< Суммарная длина ФИО
+};
+
+/**
+ * @brief Оценить число строк и длину ФИО по первым sample строкам
+ * @param filename имя датасета
+ * @param sample число строк для оценки
+ */
+inline DatasetEstimate estimate_dataset(const std::string &filename,
+                                        std::size_t sample = 1000) {
+  DatasetEstimate e;
+  std::error_code ec;
+  e.file_bytes = std::filesystem::file_size(filename, ec);
+  if (ec)
+    return e;
+
+  std::ifstream ifile(filename);
+  std::string line;
+  std::size_t lines{0}, line_bytes{0}, name_bytes{0};
+  while (lines < sample && std::getline(ifile, line)) {
+    ++lines;
+    line_bytes += line.size() + 1;
+    name_bytes += std::min(line.find(','), line.size());
+  }
+  if (lines == 0)
+    return e;
+  e.rows = e.file_bytes * lines / line_bytes;
+  e.name_bytes = e.file_bytes * name_bytes / line_bytes;
+  return e;
+}
+
+/**
+ * @brief Считать датасет военнослужащих
+ * @param filename Имя датасета (например, "dataset_1.csv")
+ * @return Вектор объектов
+ */
+inline std::vector<Soldier> read_csv(const std::string &filename) {
+  LAB1_PROBE1(read_csv_start, filename.c_str());
+  std::vector<Soldier> data;
+  const std::size_t rows = estimate_dataset(filename).rows;
+  data.reserve(rows + rows / 16);
+  std::ifstream ifile;
+  std::string line;
+
+  ifile.open(filename);
+  if (!ifile.is_open()) {
+    std::cerr << "read_csv: Couldn't open file\n";
+  }
+
+  std::uint64_t bytes{0};
+  while (std::getline(ifile, line)) {
+    bytes += line.size() + 1;
+    std::vector<std::string> fields_v = split(line, ',');
+    Soldier obj(fields_v[0], fields_v[1], fields_v[2], std::stoi(fields_v[3]));
+    data.emplace_back(obj);
+  }
+
+  lab_metrics().rows_parsed.add(data.size());
+  lab_metrics().bytes_read.add(bytes);
+  LAB1_PROBE2(read_csv_end, filename.c_str(), data.size());
+  return data;
+}
+
+/**
+ * @brief Записать вектор данных в .csv файл
+ * @param filename имя файла
+ * @param data вектор объектов
+ * @return true, если файл записан
+ */
+inline bool write_csv(std::string filename,
+                      const std::vector<Soldier> &data) {
+  LAB1_PROBE2(write_csv_start, filename.c_str(), data.size());
+  std::ofstream ofile(filename);
+  if (!ofile.is_open()) {
+    std::cerr << "read_csv: Couldn't open file\n";
+  }
+  for (const auto &v : data) {
+    ofile << v.full_name << ',' << v.job << ',' << v.unit << ',' << v.salary
+          << '\n';
+  }
+  ofile.flush();
+  const std::streamoff written = ofile.tellp();
+  lab_metrics().bytes_written.add(written > 0 ? written : 0);
+  LAB1_PROBE2(write_csv_end, filename.c_str(), data.size());
+  return ofile.good();
+}
+
+/**
+ * @brief Построчное чтение датасета военнослужащих
+ *
+ * В отличие от read_csv() не загружает файл целиком: в памяти находится
+ * только буфер потока и текущая строка.
+ */
+class SoldierReader {
+public:
+  /// Открыть датасет для чтения
+  explicit SoldierReader(const std::string &filename) : ifile(filename) {
+    if (!ifile.is_open()) {
+      std::cerr << "SoldierReader: Couldn't open file\n";
+    }
+  }
+
+  /**
+   * @brief Считать следующую строку
+   * @param s объект, в который записывается строка
+   * @return false, если файл закончился
+   */
+  bool next(Soldier &s) {
+    if (!std::getline(ifile, line)) {
+      return false;
+    }
+    std::vector<std::string> fields_v = split(line, ',');
+    s = Soldier(fields_v[0], fields_v[1], fields_v[2], std::stoi(fields_v[3]));
+    return true;
+  }
+
+private:
+  std::ifstream ifile;
+  std::string line;
+};
+
+/**
+ * @brief Записать одну строку датасета в поток в формате .csv
+ * @param os поток вывода
+ * @param v объект
+ */
+inline void write_row(std::ostream &os, const Soldier &v) {
+  os << v.full_name << ',' << v.job << ',' << v.unit << ',' << v.salary
+     << '\n';
+}
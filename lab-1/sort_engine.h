@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>   // std::min
+#include <array>       // std::array
+#include <concepts>    // std::integral, std::convertible_to
+#include <cstdint>     // std::uint32_t
+#include <functional>  // std::identity, std::invoke
+#include <iterator>    // std::iter_value_t, std::random_access_iterator
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <type_traits> // std::make_unsigned_t, std::is_lvalue_reference_v
+#include <utility>     // std::pair, std::move
+#include <vector>      // std::vector
+
+#include "sorts.h" // merge_sort
+
+/// Ключ, сортируемый поразрядно как целое число
+template <class K>
+concept IntegralKey = std::integral<std::remove_cvref_t<K>> &&
+                      !std::same_as<std::remove_cvref_t<K>, bool>;
+
+/// Ключ, сортируемый как строка
+template <class K>
+concept StringKey = !IntegralKey<K> && std::convertible_to<K, std::string_view>;
+
+/// Результат проекции элемента диапазона
+template <class It, class Proj>
+using projected_key_t = std::invoke_result_t<Proj &, std::iter_reference_t<It>>;
+
+/**
+ * @brief Поразрядная сортировка (LSD) по целочисленному ключу
+ *
+ * Ключи приводятся к беззнаковым (с инверсией знакового бита), пары
+ * (ключ, номер элемента) сортируются по байту за проход; проходы, где
+ * все ключи имеют одинаковый байт, пропускаются. Затем элементы
+ * переставляются один раз. Сортировка устойчива.
+ *
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param proj проекция элемента на ключ
+ */
+template <std::random_access_iterator RandomAccessIterator, class Proj>
+void radix_sort(RandomAccessIterator first, RandomAccessIterator last,
+                Proj proj) {
+  using Key = std::remove_cvref_t<projected_key_t<RandomAccessIterator, Proj>>;
+  using UKey = std::make_unsigned_t<Key>;
+  const std::size_t n = last - first;
+  if (n < 2)
+    return;
+
+  constexpr UKey sign =
+      std::is_signed_v<Key> ? UKey{1} << (sizeof(UKey) * 8 - 1) : UKey{0};
+  std::vector<std::pair<UKey, std::uint32_t>> items(n), buffer(n);
+  for (std::size_t i{0}; i < n; ++i) {
+    items[i] = {static_cast<UKey>(std::invoke(proj, first[i])) ^ sign,
+                static_cast<std::uint32_t>(i)};
+  }
+
+  for (unsigned shift{0}; shift < sizeof(UKey) * 8; shift += 8) {
+    std::array<std::size_t, 257> count{};
+    for (const auto &it : items)
+      ++count[((it.first >> shift) & 0xff) + 1];
+    if (count[((items[0].first >> shift) & 0xff) + 1] == n)
+      continue;
+    for (std::size_t d{0}; d < 256; ++d)
+      count[d + 1] += count[d];
+    for (const auto &it : items)
+      buffer[count[(it.first >> shift) & 0xff]++] = it;
+    items.swap(buffer);
+  }
+
+  std::vector<std::iter_value_t<RandomAccessIterator>> sorted;
+  sorted.reserve(n);
+  for (const auto &it : items)
+    sorted.push_back(std::move(first[it.second]));
+  std::move(sorted.begin(), sorted.end(), first);
+}
+
+namespace detail {
+
+/// Символ строки на глубине d (или -1, если строка короче)
+inline int char_at(std::string_view s, std::size_t d) {
+  return d < s.size() ? static_cast<unsigned char>(s[d]) : -1;
+}
+
+/// Трёхпутевая поразрядная быстрая сортировка (Бентли-Седжвик)
+inline void multikey_quicksort(std::pair<std::string_view, std::uint32_t> *a,
+                               std::ptrdiff_t n, std::size_t d) {
+  while (n > 16) {
+    const int pivot = char_at(a[n / 2].first, d);
+    std::ptrdiff_t lt{0}, i{0}, gt = n;
+    while (i < gt) {
+      const int c = char_at(a[i].first, d);
+      if (c < pivot)
+        std::swap(a[lt++], a[i++]);
+      else if (c > pivot)
+        std::swap(a[i], a[--gt]);
+      else
+        ++i;
+    }
+    multikey_quicksort(a, lt, d);
+    multikey_quicksort(a + gt, n - gt, d);
+    if (pivot < 0)
+      return;
+    a += lt;
+    n = gt - lt;
+    ++d;
+  }
+  // Вставка с ранним выходом; первые d символов у части общие, поэтому
+  // строки сравниваются с глубины d
+  auto suffix = [d](std::string_view s) {
+    return s.substr(std::min(d, s.size()));
+  };
+  for (std::ptrdiff_t i{1}; i < n; ++i) {
+    const auto t = a[i];
+    const auto key = suffix(t.first);
+    std::ptrdiff_t j = i;
+    for (; j > 0 && key < suffix(a[j - 1].first); --j)
+      a[j] = a[j - 1];
+    a[j] = t;
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Сортировка по строковому ключу
+ *
+ * Пары (ключ, номер элемента) сортируются трёхпутевой поразрядной
+ * быстрой сортировкой: общие префиксы ключей сравниваются один раз, а
+ * не при каждом сравнении, как в сортировках сравнением. Затем элементы
+ * переставляются один раз.
+ *
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param proj проекция элемента на строковый ключ
+ */
+template <std::random_access_iterator RandomAccessIterator, class Proj>
+void string_sort(RandomAccessIterator first, RandomAccessIterator last,
+                 Proj proj) {
+  using Key = projected_key_t<RandomAccessIterator, Proj>;
+  const std::size_t n = last - first;
+  if (n < 2)
+    return;
+
+  // Проекция по значению возвращает временные строки - их нужно сохранить
+  std::vector<std::string> owned;
+  std::vector<std::pair<std::string_view, std::uint32_t>> items(n);
+  if constexpr (!std::is_lvalue_reference_v<Key>) {
+    owned.reserve(n);
+  }
+  for (std::size_t i{0}; i < n; ++i) {
+    if constexpr (std::is_lvalue_reference_v<Key>) {
+      items[i] = {std::string_view(std::invoke(proj, first[i])),
+                  static_cast<std::uint32_t>(i)};
+    } else {
+      owned.emplace_back(std::string_view(std::invoke(proj, first[i])));
+      items[i] = {owned.back(), static_cast<std::uint32_t>(i)};
+    }
+  }
+
+  detail::multikey_quicksort(items.data(), n, 0);
+
+  std::vector<std::iter_value_t<RandomAccessIterator>> sorted;
+  sorted.reserve(n);
+  for (const auto &it : items)
+    sorted.push_back(std::move(first[it.second]));
+  std::move(sorted.begin(), sorted.end(), first);
+}
+
+/**
+ * @brief Отсортировать диапазон по ключу, выбрав алгоритм при компиляции
+ *
+ * Выбор делается по типу ключа proj(элемент) и категории итератора,
+ * без проверок во время выполнения:
+ * - целочисленный ключ - radix_sort();
+ * - строковый ключ (std::string, std::string_view, const char*) -
+ *   string_sort();
+ * - иначе (кортежи через std::tie, Soldier и т.п.) - merge_sort() с
+ *   сравнением проекций;
+ * - не random access итераторы - через временный std::vector.
+ *
+ * Названа sort_by, а не sort, чтобы не конфликтовать с std::sort при
+ * поиске по аргументам (ADL).
+ *
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param proj проекция элемента на ключ (по умолчанию - сам элемент)
+ */
+template <std::forward_iterator ForwardIterator, class Proj = std::identity>
+void sort_by(ForwardIterator first, ForwardIterator last, Proj proj = {}) {
+  using Key = projected_key_t<ForwardIterator, Proj>;
+
+  if constexpr (!std::random_access_iterator<ForwardIterator>) {
+    std::vector<std::iter_value_t<ForwardIterator>> tmp(
+        std::make_move_iterator(first), std::make_move_iterator(last));
+    sort_by(tmp.begin(), tmp.end(), proj);
+    std::move(tmp.begin(), tmp.end(), first);
+  } else if constexpr (IntegralKey<Key>) {
+    radix_sort(first, last, proj);
+  } else if constexpr (StringKey<Key>) {
+    string_sort(first, last, proj);
+  } else {
+    if (last - first > 1) {
+      merge_sort(first, last, [&](const auto &a, const auto &b) {
+        return std::invoke(proj, a) < std::invoke(proj, b);
+      });
+    }
+  }
+}
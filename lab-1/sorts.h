@@ -0,0 +1,353 @@
+#pragma once
+
+#include <algorithm>   // std::copy, std::iter_swap
+#include <concepts>    // std::default_initializable
+#include <cstring>     // std::memcpy, std::memmove
+#include <iterator>    // std::random_access_iterator (concept)
+#include <memory>      // std::to_address
+#include <type_traits> // std::is_trivially_copyable_v
+#include <vector>      // std::vector
+
+#include "cancel.h" // CancelToken, cancelled
+#include "trace.h"  // LAB1_PROBE2
+
+/**
+ * @brief Итератор по непрерывной памяти с тривиально копируемыми элементами
+ *
+ * Для таких диапазонов (ключи, номера строк, записи фиксированной длины)
+ * сортировки ниже работают по сырым указателям и сдвигают блоки через
+ * std::memmove вместо поэлементного копирования и std::iter_swap.
+ */
+template <class It>
+concept TriviallyCopyableRange =
+    std::contiguous_iterator<It> &&
+    std::is_trivially_copyable_v<std::iter_value_t<It>> &&
+    std::default_initializable<std::iter_value_t<It>>;
+
+namespace detail {
+
+/// Сортировка вставкой по указателям: поиск места и сдвиг блока memmove
+template <class T, class Compare>
+void insertion_sort_trivial(T *first, T *last, Compare comp,
+                            const CancelToken *token) {
+  for (T *i = first + 1; i < last && !cancelled(token); ++i) {
+    const T t = *i;
+    T *j = i;
+    while (j > first && comp(t, *(j - 1))) {
+      --j;
+    }
+    if (j != i) {
+      std::memmove(j + 1, j, (i - j) * sizeof(T));
+      *j = t;
+    }
+  }
+}
+
+/**
+ * @brief Шейкер-сортировка по указателям
+ *
+ * Обмен соседей записан без ветвлений (выбором значений), что на
+ * случайных данных избавляет от ошибок предсказания переходов.
+ */
+template <class T, class Compare>
+void shaker_sort_trivial(T *first, T *last, Compare comp,
+                         const CancelToken *token) {
+  T *left = first, *right = last - 1;
+  bool swapped = true;
+  auto exchange = [&](T *a) {
+    const T x = *a, y = *(a + 1);
+    const bool c = comp(y, x);
+    *a = c ? y : x;
+    *(a + 1) = c ? x : y;
+    swapped |= c;
+  };
+  while (left < right && swapped && !cancelled(token)) {
+    swapped = false;
+    for (T *i = left; i < right; ++i) {
+      exchange(i);
+    }
+    --right;
+    for (T *i = right; i > left; --i) {
+      exchange(i - 1);
+    }
+    ++left;
+  }
+}
+
+/**
+ * @brief Слияние соседних отсортированных [first, mid) и [mid, last)
+ *
+ * Во внешний буфер копируется только левая половина, правая
+ * сливается на месте; хвосты переносятся одним memcpy.
+ */
+template <class T, class Compare>
+void merge_trivial(T *first, T *mid, T *last, T *buffer, Compare comp) {
+  LAB1_PROBE2(merge, mid - first, last - mid);
+  const std::size_t left = mid - first;
+  std::memcpy(buffer, first, left * sizeof(T));
+  T *i = buffer, *i_last = buffer + left, *j = mid, *out = first;
+  while (i < i_last && j < last) {
+    if (comp(*j, *i)) {
+      *out++ = *j++;
+    } else {
+      *out++ = *i++;
+    }
+  }
+  std::memcpy(out, i, (i_last - i) * sizeof(T));
+}
+
+/// Сортировка слиянием по указателям с общим буфером на половину диапазона
+template <class T, class Compare>
+void merge_sort_trivial(T *first, T *last, T *buffer, Compare comp,
+                        const CancelToken *token) {
+  if (last - first <= 16) {
+    insertion_sort_trivial(first, last, comp, nullptr);
+    return;
+  }
+  T *mid = first + (last - first) / 2;
+  merge_sort_trivial(first, mid, buffer, comp, token);
+  merge_sort_trivial(mid, last, buffer, comp, token);
+  if (!cancelled(token) && comp(*mid, *(mid - 1))) {
+    merge_trivial(first, mid, last, buffer, comp);
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Сортировка вставкой
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param comp фукнция сравнения
+ * @param token токен отмены (nullptr - без отмены)
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void insertion_sort(RandomAccessIterator first, RandomAccessIterator last,
+                    Compare comp, const CancelToken *token = nullptr) {
+  if constexpr (TriviallyCopyableRange<RandomAccessIterator>) {
+    if (last - first > 1)
+      detail::insertion_sort_trivial(std::to_address(first),
+                                     std::to_address(last), comp, token);
+    return;
+  }
+
+  for (auto i = first + 1; i < last && !cancelled(token); ++i) {
+    auto t = *i;
+    for (auto j = i - 1; j >= first; --j) {
+      if (comp(t, *j)) {
+        std::iter_swap(j, j + 1);
+      }
+    }
+  }
+}
+// 4,5,1,3,2
+// 1,4,5,3,2
+// 1,3,4,5,2
+// 1,2,3,4,5
+
+/**
+ * @brief Шейкер-сортировка
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param comp фукнция сравнения
+ * @param token токен отмены (nullptr - без отмены)
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void shaker_sort(RandomAccessIterator first, RandomAccessIterator last,
+                 Compare comp, const CancelToken *token = nullptr) {
+  if constexpr (TriviallyCopyableRange<RandomAccessIterator>) {
+    if (last - first > 1)
+      detail::shaker_sort_trivial(std::to_address(first),
+                                  std::to_address(last), comp, token);
+    return;
+  }
+
+  auto left_bound = first;
+  auto right_bound = last - 1;
+  bool no_swaps = true;
+
+  while (left_bound <= right_bound && !cancelled(token)) {
+    for (auto i = left_bound; i < right_bound; ++i) {
+      if (comp(*(i + 1), *i)) {
+        std::iter_swap(i + 1, i);
+        no_swaps = false;
+      }
+    }
+    ++left_bound;
+    if (no_swaps)
+      break;
+
+    for (auto i = right_bound; i >= left_bound; --i) {
+      if (comp(*i, *(i - 1))) {
+        std::iter_swap(i, i - 1);
+      }
+    }
+    --right_bound;
+    if (no_swaps)
+      break;
+  }
+}
+
+// 5,4,1,3,2
+//
+
+/**
+ * @brief  Функция для слияния двух отсортированных массивов при сортировке
+ * слиянием
+ * @param l_first итератор на начало 1-ого контейнера
+ * @param l_last итератор на конец 1-ого контейнера
+ * @param r_first итератор на начало 2-ого контейнера
+ * @param r_last итератор на конец 2-ого контейнера
+ * @param comp функция сравнения
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void merge(RandomAccessIterator l_first, RandomAccessIterator l_last,
+           RandomAccessIterator r_first, RandomAccessIterator r_last,
+           Compare comp) {
+  if constexpr (TriviallyCopyableRange<RandomAccessIterator>) {
+    if (l_last == r_first) {
+      std::vector<std::iter_value_t<RandomAccessIterator>> buffer(l_last -
+                                                                  l_first);
+      detail::merge_trivial(std::to_address(l_first), std::to_address(l_last),
+                            std::to_address(r_last), buffer.data(), comp);
+      return;
+    }
+  }
+
+  LAB1_PROBE2(merge, l_last - l_first, r_last - r_first);
+  std::vector result(l_first, l_last);
+  result.clear();
+
+  auto i = l_first, j = r_first;
+  while (i < l_last and j < r_last) {
+    if (comp(*i, *j)) {
+      result.push_back(*i);
+      ++i;
+    } else {
+      result.push_back(*j);
+      ++j;
+    }
+  }
+
+  for (; i < l_last; ++i) {
+    result.push_back(*i);
+  }
+
+  for (; j < r_last; ++j) {
+    result.push_back(*j);
+  }
+
+  std::copy(result.begin(), result.end(), l_first);
+}
+
+/**
+ * @brief Сортировка слиянием
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param comp фукнция сравнения
+ * @param token токен отмены (nullptr - без отмены)
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+void merge_sort(RandomAccessIterator first, RandomAccessIterator last,
+                Compare comp, const CancelToken *token = nullptr) {
+  if constexpr (TriviallyCopyableRange<RandomAccessIterator>) {
+    if (last - first > 1) {
+      std::vector<std::iter_value_t<RandomAccessIterator>> buffer(
+          (last - first) / 2 + 1);
+      detail::merge_sort_trivial(std::to_address(first),
+                                 std::to_address(last), buffer.data(), comp,
+                                 token);
+    }
+    return;
+  }
+
+  if (first + 1 == last) {
+    return;
+  }
+
+  long mid = std::distance(first, last) / 2;
+
+  merge_sort(first, first + mid, comp, token);
+  merge_sort(first + mid, last, comp, token);
+  if (cancelled(token)) {
+    return;
+  }
+
+  return merge(first, first + mid, first + mid, last, comp);
+}
+
+/**
+ * @brief Слияние двух отсортированных массивов с удалением повторов
+ *
+ * Как merge(), но элемент, эквивалентный последнему записанному,
+ * пропускается. Результат записывается начиная с l_first.
+ *
+ * @param l_first итератор на начало 1-ого контейнера
+ * @param l_last итератор на конец 1-ого контейнера
+ * @param r_first итератор на начало 2-ого контейнера
+ * @param r_last итератор на конец 2-ого контейнера
+ * @param comp функция сравнения
+ * @return итератор на конец результата
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+RandomAccessIterator merge_unique(RandomAccessIterator l_first,
+                                  RandomAccessIterator l_last,
+                                  RandomAccessIterator r_first,
+                                  RandomAccessIterator r_last, Compare comp) {
+  std::vector result(l_first, l_last);
+  result.clear();
+
+  auto push = [&](auto &v) {
+    if (result.empty() || comp(result.back(), v)) {
+      result.push_back(v);
+    }
+  };
+
+  auto i = l_first, j = r_first;
+  while (i < l_last and j < r_last) {
+    if (comp(*j, *i)) {
+      push(*j);
+      ++j;
+    } else {
+      push(*i);
+      ++i;
+    }
+  }
+
+  for (; i < l_last; ++i) {
+    push(*i);
+  }
+
+  for (; j < r_last; ++j) {
+    push(*j);
+  }
+
+  return std::copy(result.begin(), result.end(), l_first);
+}
+
+/**
+ * @brief Сортировка слиянием с удалением повторов
+ *
+ * Половины сортируются обычной merge_sort(), а повторы отбрасываются
+ * на последнем слиянии, поэтому отдельный проход std::unique не нужен.
+ *
+ * @param first итератор на начало контейнера
+ * @param last итератор на конец контейнера
+ * @param comp фукнция сравнения
+ * @return итератор на конец неповторяющихся элементов
+ */
+template <std::random_access_iterator RandomAccessIterator, class Compare>
+RandomAccessIterator merge_sort_unique(RandomAccessIterator first,
+                                       RandomAccessIterator last,
+                                       Compare comp) {
+  if (last - first < 2) {
+    return last;
+  }
+
+  long mid = std::distance(first, last) / 2;
+
+  merge_sort(first, first + mid, comp);
+  merge_sort(first + mid, last, comp);
+
+  return merge_unique(first, first + mid, first + mid, last, comp);
+}
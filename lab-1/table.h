@@ -0,0 +1,481 @@
+#pragma once
+
+#include <algorithm>   // std::count, std::min, std::max
+#include <charconv>    // std::from_chars
+#include <cstdint>     // std::uint32_t, std::int32_t, std::int64_t, ...
+#include <fstream>     // std::ifstream, std::ofstream
+#include <iostream>    // std::cerr
+#include <numeric>     // std::iota
+#include <optional>    // std::optional
+#include <ostream>     // std::ostream
+#include <string>      // std::string, std::getline
+#include <string_view> // std::string_view
+#include <type_traits> // std::is_same_v, std::decay_t
+#include <utility>     // std::move
+#include <variant>     // std::variant, std::visit
+#include <vector>      // std::vector
+
+#include "columns.h" // Dictionary
+#include "metrics.h" // lab_metrics
+#include "soldier.h" // split, estimate_dataset
+#include "sorts.h"   // merge_sort
+
+/// Тип столбца таблицы
+enum class ColumnType {
+  string,     ///< Произвольные строки (ФИО)
+  dictionary, ///< Строки с малым числом различных значений (коды словаря)
+  int32,      ///< Целые числа
+  decimal     ///< Числа с фиксированной точкой (scale знаков после точки)
+};
+
+/// Описание столбца
+struct ColumnSpec {
+  std::string name; ///< Имя столбца
+  ColumnType type;  ///< Тип
+  int scale{0};     ///< Знаков после точки (для decimal)
+};
+
+/// Схема таблицы: столбцы в порядке следования в .csv
+using Schema = std::vector<ColumnSpec>;
+
+/**
+ * @brief Разобрать схему вида "full_name:string,job:dict,price:decimal(2)"
+ *
+ * Типы: string, dict, int, decimal(<знаков после точки>).
+ *
+ * @param spec список столбцов через запятую
+ * @return Схема либо std::nullopt, если тип не распознан
+ */
+inline std::optional<Schema> parse_schema(const std::string &spec) {
+  Schema schema;
+  for (const auto &column : split(spec, ',')) {
+    const auto colon = column.find(':');
+    if (colon == std::string::npos)
+      return std::nullopt;
+    ColumnSpec c{column.substr(0, colon), ColumnType::string};
+    const std::string type = column.substr(colon + 1);
+    if (type == "string")
+      c.type = ColumnType::string;
+    else if (type == "dict")
+      c.type = ColumnType::dictionary;
+    else if (type == "int")
+      c.type = ColumnType::int32;
+    else if (type.rfind("decimal(", 0) == 0 && type.back() == ')') {
+      c.type = ColumnType::decimal;
+      // Между скобками - только число
+      const char *first = type.data() + sizeof("decimal(") - 1;
+      const char *last = type.data() + type.size() - 1;
+      const auto [end, ec] = std::from_chars(first, last, c.scale);
+      if (ec != std::errc() || end != last || c.scale < 0 || c.scale > 18)
+        return std::nullopt;
+    } else
+      return std::nullopt;
+    schema.push_back(c);
+  }
+  if (schema.empty())
+    return std::nullopt;
+  return schema;
+}
+
+/// Схема датасетов военнослужащих
+inline Schema soldier_schema() {
+  return *parse_schema("full_name:string,job:dict,unit:dict,salary:int");
+}
+
+/// Столбец строк: символы всех строк подряд и концы строк
+struct StringColumn {
+  std::string chars;               ///< Символы строк подряд
+  std::vector<std::uint32_t> ends; ///< Конец строки r в chars
+
+  void push_back(std::string_view s) {
+    chars.append(s);
+    ends.push_back(static_cast<std::uint32_t>(chars.size()));
+  }
+  std::string_view operator[](std::size_t r) const {
+    const std::uint32_t begin = r == 0 ? 0 : ends[r - 1];
+    return std::string_view(chars).substr(begin, ends[r] - begin);
+  }
+  bool less(std::uint32_t a, std::uint32_t b) const {
+    return (*this)[a] < (*this)[b];
+  }
+  bool equal(std::uint32_t a, std::uint32_t b) const {
+    return (*this)[a] == (*this)[b];
+  }
+  void write(std::ostream &os, std::uint32_t r) const { os << (*this)[r]; }
+};
+
+/// Столбец строк, закодированных словарём (после finalize() коды упорядочены)
+struct DictionaryColumn {
+  std::vector<std::uint32_t> codes; ///< Коды строк
+  Dictionary dict;                  ///< Словарь
+  std::string scratch;              ///< Буфер для encode()
+
+  void push_back(std::string_view s) {
+    codes.push_back(dict.encode(scratch.assign(s)));
+  }
+  bool less(std::uint32_t a, std::uint32_t b) const {
+    return codes[a] < codes[b];
+  }
+  bool equal(std::uint32_t a, std::uint32_t b) const {
+    return codes[a] == codes[b];
+  }
+  void write(std::ostream &os, std::uint32_t r) const {
+    os << dict.values[codes[r]];
+  }
+};
+
+/// Столбец целых чисел
+struct IntColumn {
+  std::vector<std::int32_t> values; ///< Значения
+
+  /// Добавить число; false (и столбец не меняется), если s - не int32
+  bool push_back(std::string_view s) {
+    if (!s.empty() && s.front() == '+')
+      s.remove_prefix(1);
+    std::int32_t v{0};
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc() || end != s.data() + s.size())
+      return false;
+    values.push_back(v);
+    return true;
+  }
+  void pop_back() { values.pop_back(); }
+  bool less(std::uint32_t a, std::uint32_t b) const {
+    return values[a] < values[b];
+  }
+  bool equal(std::uint32_t a, std::uint32_t b) const {
+    return values[a] == values[b];
+  }
+  void write(std::ostream &os, std::uint32_t r) const { os << values[r]; }
+};
+
+/**
+ * @brief Столбец чисел с фиксированной точкой
+ *
+ * Значение хранится целым числом единиц последнего знака: при scale = 2
+ * "12.5" хранится как 1250. Лишние знаки после точки отбрасываются.
+ */
+struct DecimalColumn {
+  std::vector<std::int64_t> values; ///< Значения, умноженные на 10^scale
+  int scale{0};                     ///< Знаков после точки
+
+  /**
+   * @brief Добавить число вида [+-]цифры[.цифры]
+   * @return false (и столбец не меняется), если s - не число этого вида
+   * или оно не помещается в int64 после умножения на 10^scale
+   */
+  bool push_back(std::string_view s) {
+    const bool negative = !s.empty() && s.front() == '-';
+    if (negative || (!s.empty() && s.front() == '+'))
+      s.remove_prefix(1);
+    const auto dot = std::min(s.find('.'), s.size());
+    std::string_view whole = s.substr(0, dot), frac = s.substr(dot);
+    if (!frac.empty())
+      frac.remove_prefix(1);
+    if (whole.empty() && frac.empty())
+      return false;
+
+    // Модуль до 2^63, чтобы помещалось и наименьшее int64
+    const std::uint64_t limit = (std::uint64_t{1} << 63) - !negative;
+    std::uint64_t v{0};
+    if (!whole.empty()) {
+      const auto [end, ec] =
+          std::from_chars(whole.data(), whole.data() + whole.size(), v);
+      if (ec != std::errc() || end != whole.data() + whole.size())
+        return false;
+    }
+    for (int i{0}; i < scale; ++i) {
+      const int digit = i < static_cast<int>(frac.size()) ? frac[i] - '0' : 0;
+      if (digit < 0 || digit > 9 || v > (limit - digit) / 10)
+        return false;
+      v = v * 10 + digit;
+    }
+    for (auto i = static_cast<std::size_t>(scale); i < frac.size(); ++i) {
+      if (frac[i] < '0' || frac[i] > '9')
+        return false;
+    }
+    if (v > limit)
+      return false;
+    values.push_back(static_cast<std::int64_t>(negative ? 0 - v : v));
+    return true;
+  }
+  void pop_back() { values.pop_back(); }
+  bool less(std::uint32_t a, std::uint32_t b) const {
+    return values[a] < values[b];
+  }
+  bool equal(std::uint32_t a, std::uint32_t b) const {
+    return values[a] == values[b];
+  }
+  void write(std::ostream &os, std::uint32_t r) const {
+    // Модуль в uint64: -v переполнилось бы для наименьшего int64
+    std::uint64_t v = static_cast<std::uint64_t>(values[r]);
+    if (values[r] < 0) {
+      os << '-';
+      v = 0 - v;
+    }
+    std::uint64_t unit{1};
+    for (int i{0}; i < scale; ++i)
+      unit *= 10;
+    os << v / unit;
+    if (scale > 0) {
+      const std::string frac = std::to_string(v % unit);
+      os << '.' << std::string(scale - frac.size(), '0') << frac;
+    }
+  }
+};
+
+/// Столбец чисел: разбор значения может не удаться (push_back -> false)
+template <class Col>
+inline constexpr bool numeric_column_v =
+    std::is_same_v<Col, IntColumn> || std::is_same_v<Col, DecimalColumn>;
+
+/// Столбец любого из типов ColumnType
+using Column =
+    std::variant<StringColumn, DictionaryColumn, IntColumn, DecimalColumn>;
+
+/**
+ * @brief Таблица со схемой, заданной во время выполнения
+ *
+ * Каждый столбец хранится в представлении своего типа (см. Column).
+ * Обработка идёт по столбцам: std::visit выбирает тип столбца один раз
+ * на проход, а внутренний цикл (сравнения при сортировке, разбор,
+ * запись) компилируется отдельно для каждого типа, как в рукописном
+ * SoldierColumns.
+ */
+struct Table {
+  Schema schema;               ///< Схема
+  std::vector<Column> columns; ///< Столбцы в порядке схемы
+  std::size_t rows{0};         ///< Число строк
+
+  /// Пустая таблица со схемой schema
+  explicit Table(Schema s) : schema(std::move(s)) {
+    for (const auto &c : schema) {
+      switch (c.type) {
+      case ColumnType::string:
+        columns.emplace_back(StringColumn{});
+        break;
+      case ColumnType::dictionary:
+        columns.emplace_back(DictionaryColumn{});
+        break;
+      case ColumnType::int32:
+        columns.emplace_back(IntColumn{});
+        break;
+      case ColumnType::decimal:
+        columns.emplace_back(DecimalColumn{{}, c.scale});
+        break;
+      }
+    }
+  }
+
+  /// Номер столбца с именем name
+  std::optional<std::size_t> find(std::string_view name) const {
+    for (std::size_t c{0}; c < schema.size(); ++c) {
+      if (schema[c].name == name)
+        return c;
+    }
+    return std::nullopt;
+  }
+};
+
+/**
+ * @brief Считать .csv файл в таблицу со схемой schema
+ *
+ * Строки с числом полей, не совпадающим со схемой, или с полем, которое
+ * не разбирается как число своего столбца, пропускаются.
+ * Коды словарных столбцов после чтения упорядочены как сами строки.
+ *
+ * @param filename имя файла
+ * @param schema схема
+ * @return Таблица
+ */
+inline Table read_table(const std::string &filename, const Schema &schema) {
+  Table table(schema);
+  std::ifstream ifile(filename);
+  if (!ifile.is_open()) {
+    std::cerr << "read_table: Couldn't open file\n";
+    return table;
+  }
+
+  const std::size_t rows = estimate_dataset(filename).rows;
+  for (auto &column : table.columns) {
+    std::visit(
+        [&](auto &col) {
+          using Col = std::decay_t<decltype(col)>;
+          if constexpr (std::is_same_v<Col, StringColumn>)
+            col.ends.reserve(rows + rows / 16);
+          else if constexpr (std::is_same_v<Col, DictionaryColumn>)
+            col.codes.reserve(rows + rows / 16);
+          else
+            col.values.reserve(rows + rows / 16);
+        },
+        column);
+  }
+
+  std::string line;
+  std::vector<std::string_view> fields(schema.size());
+  std::uint64_t bytes{0}, skipped{0};
+  while (std::getline(ifile, line)) {
+    bytes += line.size() + 1;
+    if (std::count(line.begin(), line.end(), ',') + 1 !=
+        static_cast<std::ptrdiff_t>(fields.size())) {
+      ++skipped;
+      continue;
+    }
+    std::string_view rest(line);
+    for (auto &f : fields) {
+      const auto comma = rest.find(',');
+      f = rest.substr(0, comma);
+      rest.remove_prefix(std::min(comma + 1, rest.size()));
+    }
+    // Сначала числа: если поле не разбирается, уже добавленные числа
+    // строки убираются и строка пропускается
+    std::size_t parsed{0};
+    for (; parsed < fields.size(); ++parsed) {
+      const bool ok = std::visit(
+          [&](auto &col) {
+            if constexpr (numeric_column_v<std::decay_t<decltype(col)>>)
+              return col.push_back(fields[parsed]);
+            else
+              return true;
+          },
+          table.columns[parsed]);
+      if (!ok)
+        break;
+    }
+    if (parsed < fields.size()) {
+      for (std::size_t c{0}; c < parsed; ++c)
+        std::visit(
+            [](auto &col) {
+              if constexpr (numeric_column_v<std::decay_t<decltype(col)>>)
+                col.pop_back();
+            },
+            table.columns[c]);
+      ++skipped;
+      continue;
+    }
+    for (std::size_t c{0}; c < fields.size(); ++c)
+      std::visit(
+          [&](auto &col) {
+            if constexpr (!numeric_column_v<std::decay_t<decltype(col)>>)
+              col.push_back(fields[c]);
+          },
+          table.columns[c]);
+    ++table.rows;
+  }
+
+  for (auto &column : table.columns) {
+    if (auto *d = std::get_if<DictionaryColumn>(&column))
+      d->dict.finalize(d->codes);
+  }
+  if (skipped > 0)
+    std::cerr << "read_table: skipped " << skipped << " malformed rows\n";
+  lab_metrics().rows_parsed.add(table.rows);
+  lab_metrics().bytes_read.add(bytes);
+  return table;
+}
+
+/**
+ * @brief Разобрать ключ сортировки вида "unit,full_name,salary"
+ * @param table таблица (имена столбцов берутся из её схемы)
+ * @param spec список столбцов через запятую
+ * @return Номера столбцов либо std::nullopt, если столбца нет в схеме
+ */
+inline std::optional<std::vector<std::size_t>>
+parse_table_key(const Table &table, const std::string &spec) {
+  std::vector<std::size_t> key;
+  for (const auto &name : split(spec, ',')) {
+    const auto c = table.find(name);
+    if (!c)
+      return std::nullopt;
+    key.push_back(*c);
+  }
+  if (key.empty())
+    return std::nullopt;
+  return key;
+}
+
+namespace detail {
+
+/**
+ * @brief Отсортировать [first, last) по столбцу key[level] и уточнить
+ * следующими столбцами ключа внутри групп равных значений
+ *
+ * columns - столбцы-варианты (Column или представления чужих буферов),
+ * у каждого типа которых есть less(a, b) и equal(a, b) по номерам строк.
+ */
+template <class Columns, class It>
+void refine_permutation(const Columns &columns,
+                        const std::vector<std::size_t> &key,
+                        std::size_t level, It first, It last) {
+  std::visit(
+      [&](const auto &col) {
+        merge_sort(first, last, [&col](std::uint32_t a, std::uint32_t b) {
+          return col.less(a, b);
+        });
+        if (level + 1 == key.size())
+          return;
+        for (It run = first; run != last;) {
+          It end = run + 1;
+          while (end != last && col.equal(*run, *end))
+            ++end;
+          if (end - run > 1)
+            refine_permutation(columns, key, level + 1, run, end);
+          run = end;
+        }
+      },
+      columns[key[level]]);
+}
+
+} // namespace detail
+
+/**
+ * @brief Построить перестановку строк, упорядочивающую таблицу по ключу
+ *
+ * Строки сортируются по первому столбцу ключа, затем каждая группа
+ * равных значений - по следующему и т.д. Каждый проход сравнивает
+ * значения одного столбца известного типа, так что сравнение
+ * встраивается в merge_sort без ветвления по типу. Сортировка
+ * устойчива.
+ *
+ * @param table таблица
+ * @param key номера столбцов в порядке приоритета
+ * @return Номера строк в порядке возрастания ключа
+ */
+inline std::vector<std::uint32_t>
+build_permutation(const Table &table, const std::vector<std::size_t> &key) {
+  std::vector<std::uint32_t> perm(table.rows);
+  std::iota(perm.begin(), perm.end(), 0);
+  if (perm.size() > 1 && !key.empty())
+    detail::refine_permutation(table.columns, key, 0, perm.begin(),
+                               perm.end());
+  return perm;
+}
+
+/**
+ * @brief Записать таблицу в .csv файл в порядке перестановки
+ * @param filename имя файла
+ * @param table таблица
+ * @param perm порядок строк
+ * @return true, если файл записан
+ */
+inline bool write_table(const std::string &filename, const Table &table,
+                        const std::vector<std::uint32_t> &perm) {
+  std::ofstream ofile(filename);
+  if (!ofile.is_open()) {
+    std::cerr << "write_table: Couldn't open file\n";
+    return false;
+  }
+  for (auto r : perm) {
+    for (std::size_t c{0}; c < table.columns.size(); ++c) {
+      if (c > 0)
+        ofile << ',';
+      std::visit([&](const auto &col) { col.write(ofile, r); },
+                 table.columns[c]);
+    }
+    ofile << '\n';
+  }
+  ofile.flush();
+  const std::streamoff written = ofile.tellp();
+  lab_metrics().bytes_written.add(written > 0 ? written : 0);
+  return ofile.good();
+}
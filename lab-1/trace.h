@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ * @file
+ * @brief Статические точки трассировки (USDT)
+ *
+ * Если при сборке доступен <sys/sdt.h> (пакет systemtap-sdt-dev), макросы
+ * LAB1_PROBEn ставят точки провайдера lab1: в коде это одна инструкция
+ * nop, аргументы вычисляются, только когда к точке подключён трассировщик
+ * (bpftrace, perf probe, stap). Без <sys/sdt.h> макросы пустые.
+ * Отключить точки явно можно флагом -DLAB1_NO_PROBES.
+ *
+ * Точки:
+ * - read_csv_start(файл), read_csv_end(файл, n);
+ * - write_csv_start(файл, n), write_csv_end(файл, n);
+ * - sort_start(датасет, n, алгоритм), sort_end(датасет, n, алгоритм);
+ * - merge(длина левой части, длина правой части) - каждое слияние в
+ *   merge_sort; уровень слияния определяется по сумме длин.
+ *
+ * Пример: bpftrace -e 'usdt:./experiment:lab1:sort_end
+ * { printf("%s %d\n", str(arg2), arg1); }'
+ */
+
+#if !defined(LAB1_NO_PROBES) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h> // STAP_PROBE1, STAP_PROBE2, STAP_PROBE3
+#define LAB1_PROBE1(name, a) STAP_PROBE1(lab1, name, a)
+#define LAB1_PROBE2(name, a, b) STAP_PROBE2(lab1, name, a, b)
+#define LAB1_PROBE3(name, a, b, c) STAP_PROBE3(lab1, name, a, b, c)
+#else
+#define LAB1_PROBE1(name, a) ((void)0)
+#define LAB1_PROBE2(name, a, b) ((void)0)
+#define LAB1_PROBE3(name, a, b, c) ((void)0)
+#endif